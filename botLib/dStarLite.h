@@ -0,0 +1,269 @@
+#pragma once
+#include "gridPath.h"
+
+//D* Lite: a path search that keeps its work between queries. It searches back from the
+//target, so when the rover moves and a few cells change cost only the part of the search
+//those cells touch is redone, the rest of the previous search is reused.
+//Stepping into a cell costs that cell's cost, 0 is a wall. Costs are at least 1, Manhattan
+//distance is the heuristic.
+struct IncrementalPathfinder
+{
+	int width = 0;
+	int height = 0;
+
+	static constexpr int WALL = 0;
+	static constexpr int INFINITE = 1 << 29;
+
+	//cells taken off the open list by the last query, for profiling
+	int expandedNodes = 0;
+
+	//all cells cost 1 and the next query starts over
+	void resize(int w, int h)
+	{
+		if (w == width && h == height) { return; }
+		width = w;
+		height = h;
+
+		int cells = w * h;
+		cost.assign(cells, 1);
+		g.assign(cells, INFINITE);
+		rhs.assign(cells, INFINITE);
+		key1.assign(cells, 0);
+		key2.assign(cells, 0);
+		changedCells.clear();
+		hasGoal = 0;
+	}
+
+	bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+
+	int getCost(int x, int y) const { return inside(x, y) ? cost[y * width + x] : WALL; }
+
+	//the change is repaired on the next query
+	void setCost(int x, int y, int newCost)
+	{
+		if (!inside(x, y)) { return; }
+		int cell = y * width + x;
+		if (cost[cell] == newCost) { return; }
+		cost[cell] = newCost;
+		changedCells.push_back(cell);
+	}
+
+	//path goes from start to target, both included. A new target starts the search over.
+	//Returns false if the target can't be reached
+	bool findPath(GridPoint start, GridPoint target, std::vector<GridPoint> &path)
+	{
+		path.clear();
+		expandedNodes = 0;
+
+		if (!inside(start.x, start.y) || !inside(target.x, target.y)) { return false; }
+
+		if (!hasGoal || target != goal)
+		{
+			restart(start, target);
+		}
+		else
+		{
+			//the keys in the heap were made from the old start, instead of redoing all of them
+			//they are kept and every new key grows by how far the start moved
+			keyModifier += manhattanDistance(lastStart, start);
+			lastStart = start;
+
+			//stepping into a changed cell changed for all of its neighbors
+			for (int cell : changedCells)
+			{
+				int x = cell % width;
+				int y = cell / width;
+				for (int d = 0; d < 4; d++)
+				{
+					int nx = x + gridDirectionX[d];
+					int ny = y + gridDirectionY[d];
+					if (inside(nx, ny)) { updateCell(ny * width + nx); }
+				}
+			}
+		}
+		changedCells.clear();
+
+		int startCell = start.y * width + start.x;
+		computeShortestPath(startCell);
+
+		if (g[startCell] >= INFINITE) { return false; }
+
+		//walk down the costs, each step to the neighbor the rest of the way is cheapest from
+		int goalCell = goal.y * width + goal.x;
+		int cell = startCell;
+		path.push_back(start);
+		while (cell != goalCell && (int)path.size() <= width * height)
+		{
+			int best = -1;
+			int bestCost = INFINITE;
+			forEachNeighbor(cell, [&](int next, int stepCost)
+			{
+				if (g[next] >= INFINITE) { return; }
+				if (stepCost + g[next] < bestCost)
+				{
+					bestCost = stepCost + g[next];
+					best = next;
+				}
+			});
+
+			if (best == -1) { path.clear(); return false; }
+			cell = best;
+			path.push_back({cell % width, cell / width});
+		}
+
+		return cell == goalCell;
+	}
+
+private:
+	template<class F>
+	void forEachNeighbor(int cell, F f)
+	{
+		int x = cell % width;
+		int y = cell / width;
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = x + gridDirectionX[d];
+			int ny = y + gridDirectionY[d];
+			if (!inside(nx, ny)) { continue; }
+
+			int next = ny * width + nx;
+			if (cost[next] == WALL) { continue; }
+			f(next, (int)cost[next]);
+		}
+	}
+
+	bool keyLess(int a1, int a2, int b1, int b2) const
+	{
+		if (a1 != b1) { return a1 < b1; }
+		return a2 < b2;
+	}
+
+	void calculateKey(int cell, int &k1, int &k2) const
+	{
+		int m = std::min(g[cell], rhs[cell]);
+		k1 = m + manhattanDistance({cell % width, cell / width}, lastStart) + keyModifier;
+		k2 = m;
+	}
+
+	void restart(GridPoint start, GridPoint target)
+	{
+		std::fill(g.begin(), g.end(), INFINITE);
+		std::fill(rhs.begin(), rhs.end(), INFINITE);
+		open.clear();
+		open.reset(width * height);
+
+		goal = target;
+		hasGoal = 1;
+		lastStart = start;
+		keyModifier = 0;
+
+		int goalCell = target.y * width + target.x;
+		rhs[goalCell] = 0;
+		calculateKey(goalCell, key1[goalCell], key2[goalCell]);
+		open.push(goalCell, heapLess());
+	}
+
+	struct HeapLess
+	{
+		const IncrementalPathfinder *p;
+		bool operator()(int a, int b) const { return p->keyLess(p->key1[a], p->key2[a], p->key1[b], p->key2[b]); }
+	};
+	HeapLess heapLess() const { return {this}; }
+
+	//rhs is the best cost through a neighbor, the cell is on the open list while g disagrees with it
+	void updateCell(int cell)
+	{
+		int goalCell = goal.y * width + goal.x;
+		if (cell != goalCell)
+		{
+			int best = INFINITE;
+			forEachNeighbor(cell, [&](int next, int stepCost)
+			{
+				if (g[next] < INFINITE) { best = std::min(best, stepCost + g[next]); }
+			});
+			rhs[cell] = best;
+		}
+
+		auto less = heapLess();
+		bool queued = open.contains(cell);
+
+		if (g[cell] != rhs[cell])
+		{
+			calculateKey(cell, key1[cell], key2[cell]);
+			if (queued) { open.changed(cell, less); }
+			else { open.push(cell, less); }
+		}
+		else if (queued)
+		{
+			open.remove(cell, less);
+		}
+	}
+
+	void computeShortestPath(int startCell)
+	{
+		auto less = heapLess();
+
+		while (!open.empty())
+		{
+			int startK1 = 0, startK2 = 0;
+			calculateKey(startCell, startK1, startK2);
+
+			int cell = open.top();
+			if (!keyLess(key1[cell], key2[cell], startK1, startK2) && rhs[startCell] == g[startCell])
+			{
+				break;
+			}
+
+			expandedNodes++;
+
+			int k1 = 0, k2 = 0;
+			calculateKey(cell, k1, k2);
+
+			if (keyLess(key1[cell], key2[cell], k1, k2))
+			{
+				//the key is out of date since the start moved
+				key1[cell] = k1;
+				key2[cell] = k2;
+				open.changed(cell, less);
+			}
+			else if (g[cell] > rhs[cell])
+			{
+				g[cell] = rhs[cell];
+				open.remove(cell, less);
+				updateNeighbors(cell);
+			}
+			else
+			{
+				g[cell] = INFINITE;
+				updateCell(cell);
+				updateNeighbors(cell);
+			}
+		}
+	}
+
+	//the neighbors step into cell, so their rhs may depend on it
+	void updateNeighbors(int cell)
+	{
+		int x = cell % width;
+		int y = cell / width;
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = x + gridDirectionX[d];
+			int ny = y + gridDirectionY[d];
+			if (inside(nx, ny)) { updateCell(ny * width + nx); }
+		}
+	}
+
+	std::vector<unsigned char> cost;
+	std::vector<int> g;
+	std::vector<int> rhs;
+	std::vector<int> key1;
+	std::vector<int> key2;
+	std::vector<int> changedCells;
+	CellHeap open;
+
+	GridPoint goal;
+	GridPoint lastStart;
+	int keyModifier = 0;
+	bool hasGoal = 0;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include "gridPath.h"
+
+//Breadth first step counts from one or more sources to every reachable cell. One sweep
+//answers which of many targets is the nearest and gives the path to any of them, instead
+//of a path search per target.
+struct DistanceField
+{
+	int width = 0;
+	int height = 0;
+
+	std::vector<int> distance; //steps from the nearest source, -1 where unreachable
+	std::vector<int> parent;   //the neighbor one step closer to a source, -1 on the sources
+
+	//sources are always in the field, even if they are not passable, a rover stands on them
+	void compute(const PassableGrid &grid, const std::vector<GridPoint> &sources)
+	{
+		width = grid.width;
+		height = grid.height;
+		distance.assign(width * height, -1);
+		parent.assign(width * height, -1);
+		queue.clear();
+
+		for (auto s : sources)
+		{
+			if (!grid.inside(s.x, s.y)) { continue; }
+			int cell = s.y * width + s.x;
+			if (distance[cell] == 0) { continue; }
+			distance[cell] = 0;
+			queue.push_back(cell);
+		}
+
+		//the queue only grows, a cell is pushed once
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			int cell = queue[i];
+			int x = cell % width;
+			int y = cell / width;
+
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + gridDirectionX[d];
+				int ny = y + gridDirectionY[d];
+				if (!grid.isPassable(nx, ny)) { continue; }
+
+				int next = ny * width + nx;
+				if (distance[next] != -1) { continue; }
+
+				distance[next] = distance[cell] + 1;
+				parent[next] = cell;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+
+	int get(int x, int y) const { return inside(x, y) ? distance[y * width + x] : -1; }
+
+	bool isReachable(int x, int y) const { return get(x, y) >= 0; }
+
+	//index of the closest reachable candidate, the first one on ties, -1 if none is reachable
+	int nearest(const std::vector<GridPoint> &candidates) const
+	{
+		int best = -1;
+		int bestDistance = 0;
+		for (int i = 0; i < (int)candidates.size(); i++)
+		{
+			int d = get(candidates[i].x, candidates[i].y);
+			if (d < 0) { continue; }
+			if (best == -1 || d < bestDistance)
+			{
+				best = i;
+				bestDistance = d;
+			}
+		}
+		return best;
+	}
+
+	//path goes from the nearest source to target, both included. Returns false if target is unreachable
+	bool pathTo(GridPoint target, std::vector<GridPoint> &path) const
+	{
+		path.clear();
+		if (!isReachable(target.x, target.y)) { return false; }
+
+		for (int c = target.y * width + target.x; c != -1; c = parent[c])
+		{
+			path.push_back({c % width, c / width});
+		}
+		std::reverse(path.begin(), path.end());
+		return true;
+	}
+
+private:
+	std::vector<int> queue;
+};
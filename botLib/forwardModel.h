@@ -0,0 +1,488 @@
+#pragma once
+#include <vector>
+#include <cctype>
+#include <algorithm>
+
+//The server's turn rules (gameStep) for bots that want to try commands before sending them.
+//A SimState is a plain value: copy it, step the copy, the original is untouched.
+//It follows the server letter by letter, including its quirks, so a command string does
+//here what it does there. Views and fog are not simulated, everything is known.
+
+static constexpr int SIM_MAX_ROVER_LIFE = 15;
+
+//the server's default, it can be changed in its settings
+static constexpr int SIM_ACID_START_TIME = 150;
+
+//U D L R, anything else is no direction
+inline bool simDirection(char c, int &dx, int &dy)
+{
+	dx = 0;
+	dy = 0;
+	switch (std::toupper((unsigned char)c))
+	{
+	case 'U': dy = -1; return true;
+	case 'D': dy = 1; return true;
+	case 'L': dx = -1; return true;
+	case 'R': dx = 1; return true;
+	}
+	return false;
+}
+
+//the server's zobrist keys (zobristKey in stuff.h), so a SimState hashes like the server's state
+inline unsigned long long simZobristKey(unsigned long long kind, unsigned long long index, unsigned long long value)
+{
+	auto mix = [](unsigned long long z)
+	{
+		//splitmix64
+		z += 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	};
+
+	return mix(mix(mix(kind) ^ index) ^ value);
+}
+
+static constexpr unsigned long long SIM_ZOBRIST_TILE = 0;
+static constexpr unsigned long long SIM_ZOBRIST_ROVER = 1;
+static constexpr unsigned long long SIM_ZOBRIST_GAME = 2;
+
+struct SimRover
+{
+	int x = 1;
+	int y = 1;
+	int life = SIM_MAX_ROVER_LIFE - 5;
+	bool hasAntena = 0;
+	bool hasBatery = 0;
+	int wheelLevel = 1;
+	int cameraLevel = 1;
+	int gunLevel = 1;
+	int drilLevel = 1;
+
+	int scannedThisTurn = 0; //up down left right
+
+	int stones = 0;
+	int iron = 0;
+	int osmium = 0;
+
+	int currentRound = 0;
+	int id = 0;
+
+	int spawnX = 1;
+	int spawnY = 1;
+
+	//same fields in the same order as the server's Player::hash
+	unsigned long long hash() const
+	{
+		unsigned long long values[] =
+		{
+			(unsigned long long)x, (unsigned long long)y,
+			(unsigned long long)life, hasAntena, hasBatery,
+			(unsigned long long)wheelLevel, (unsigned long long)cameraLevel,
+			(unsigned long long)gunLevel, (unsigned long long)drilLevel,
+			(unsigned long long)scannedThisTurn,
+			(unsigned long long)stones, (unsigned long long)iron, (unsigned long long)osmium,
+			(unsigned long long)currentRound,
+			(unsigned long long)spawnX, (unsigned long long)spawnY,
+		};
+
+		unsigned long long h = 0;
+		for (unsigned long long i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+		{
+			h ^= simZobristKey(SIM_ZOBRIST_ROVER, (unsigned long long)id * 32 + i, values[i]);
+		}
+		return h;
+	}
+};
+
+struct SimState
+{
+	int width = 0;
+	int height = 0;
+	std::vector<char> tiles;      //server tile letters, y * width + x
+	std::vector<SimRover> rovers; //in turn order
+	int waitingFor = 0;           //index of the rover whose turn it is
+
+	int borderCulldown = SIM_ACID_START_TIME;
+	int currentBorderAdvance = 0;
+
+	//zobrist hash of the tiles, kept up to date by set. Call rehashTiles after writing tiles directly
+	unsigned long long tileHash = 0;
+
+	void create(int w, int h, char tile)
+	{
+		width = w;
+		height = h;
+		tiles.assign(w * h, tile);
+		rehashTiles();
+	}
+
+	bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+	char get(int x, int y) const { return tiles[y * width + x]; }
+
+	void set(int x, int y, char tile)
+	{
+		char &t = tiles[y * width + x];
+		tileHash ^= tileKey(y * width + x, t) ^ tileKey(y * width + x, tile);
+		t = tile;
+	}
+
+	static unsigned long long tileKey(int cell, char tile)
+	{
+		return simZobristKey(SIM_ZOBRIST_TILE, cell, (unsigned char)tile);
+	}
+
+	void rehashTiles()
+	{
+		tileHash = 0;
+		for (int i = 0; i < (int)tiles.size(); i++) { tileHash ^= tileKey(i, tiles[i]); }
+	}
+
+	//the same hash the server writes to game/hashes.txt for the same state, for transposition
+	//tables. The tiles are kept up to date, the rovers are a few numbers each
+	unsigned long long hash() const
+	{
+		unsigned long long h = tileHash;
+		for (auto &r : rovers) { h ^= r.hash(); }
+
+		if (!rovers.empty()) { h ^= simZobristKey(SIM_ZOBRIST_GAME, 0, rovers[waitingFor].id); }
+		h ^= simZobristKey(SIM_ZOBRIST_GAME, 1, borderCulldown);
+		h ^= simZobristKey(SIM_ZOBRIST_GAME, 2, currentBorderAdvance);
+		return h;
+	}
+
+	//index of the rover standing there, -1 if none
+	int roverAt(int x, int y) const
+	{
+		for (int i = 0; i < (int)rovers.size(); i++)
+		{
+			if (rovers[i].x == x && rovers[i].y == y) { return i; }
+		}
+		return -1;
+	}
+
+	int indexOf(int id) const
+	{
+		for (int i = 0; i < (int)rovers.size(); i++)
+		{
+			if (rovers[i].id == id) { return i; }
+		}
+		return -1;
+	}
+
+	//air, base and acid can be driven on, bullets fly through them
+	static bool isOpen(char tile) { return tile == '.' || tile == 'E' || tile == 'F'; }
+
+	static bool isMinable(char tile) { return tile == 'X' || tile == 'A' || tile == 'C' || tile == 'D'; }
+
+#pragma region single commands
+
+	//What the server does for one command letter. The phase rules of a turn (moves first,
+	//one action, buying last) are checked by applyCommands, not here.
+
+	bool move(int rover, char direction)
+	{
+		int dx, dy;
+		if (!simDirection(direction, dx, dy)) { return false; }
+
+		auto &r = rovers[rover];
+		int nx = r.x + dx;
+		int ny = r.y + dy;
+
+		if (roverAt(nx, ny) >= 0) { return false; }
+		if (!inside(nx, ny)) { return false; }
+		if (!isOpen(get(nx, ny))) { return false; }
+
+		r.x = nx;
+		r.y = ny;
+		return true;
+	}
+
+	//the bullet flies gunLevel cells, the damage drops by one every cell
+	void attack(int rover, char direction)
+	{
+		int dx, dy;
+		if (!simDirection(direction, dx, dy)) { return; }
+
+		int x = rovers[rover].x;
+		int y = rovers[rover].y;
+
+		for (int i = rovers[rover].gunLevel; i > 0; i--)
+		{
+			x += dx;
+			y += dy;
+
+			int hit = roverAt(x, y);
+			if (hit >= 0)
+			{
+				rovers[hit].life -= i;
+				break;
+			}
+
+			if (inside(x, y) && !isOpen(get(x, y))) { break; }
+		}
+	}
+
+	bool mine(int rover, char direction)
+	{
+		int dx, dy;
+		if (!simDirection(direction, dx, dy)) { return false; }
+
+		auto &r = rovers[rover];
+		int x = r.x + dx;
+		int y = r.y + dy;
+		if (!inside(x, y)) { return false; }
+
+		switch (get(x, y))
+		{
+		case 'X': case 'A': r.stones++; break;
+		case 'C': r.iron++; break;
+		case 'D': r.osmium++; break;
+		default: return false;
+		}
+
+		set(x, y, '.');
+		return true;
+	}
+
+	//cobble stone on air, a stone from the inventory
+	bool place(int rover, char direction)
+	{
+		int dx, dy;
+		if (!simDirection(direction, dx, dy)) { return false; }
+
+		auto &r = rovers[rover];
+		int x = r.x + dx;
+		int y = r.y + dy;
+		if (!inside(x, y)) { return false; }
+		if (roverAt(x, y) >= 0) { return false; }
+		if (get(x, y) != '.' || r.stones <= 0) { return false; }
+
+		set(x, y, 'A');
+		r.stones--;
+		return true;
+	}
+
+	void scan(int rover, char direction)
+	{
+		auto &r = rovers[rover];
+		if (!r.hasAntena) { return; }
+
+		switch (std::toupper((unsigned char)direction))
+		{
+		case 'U': r.scannedThisTurn = 1; break;
+		case 'D': r.scannedThisTurn = 2; break;
+		case 'L': r.scannedThisTurn = 3; break;
+		case 'R': r.scannedThisTurn = 4; break;
+		}
+	}
+
+	//S camera, A gun, D drill, M wheels, R antenna, B battery, H heal. Only with a battery or on the spawn point
+	static bool canBuy(const SimRover &r, char item)
+	{
+		if (!r.hasBatery && !(r.x == r.spawnX && r.y == r.spawnY)) { return false; }
+
+		auto upgrade = [&](int level)
+		{
+			if (level == 1) { return r.iron >= 3; }
+			if (level == 2) { return r.iron >= 6 && r.osmium >= 1; }
+			return false;
+		};
+
+		switch (std::toupper((unsigned char)item))
+		{
+		case 'S': return upgrade(r.cameraLevel);
+		case 'A': return upgrade(r.gunLevel);
+		case 'D': return upgrade(r.drilLevel);
+		case 'M': return upgrade(r.wheelLevel);
+		case 'R': return !r.hasAntena && r.iron >= 2 && r.osmium >= 1;
+		case 'B': return !r.hasBatery && r.iron >= 1 && r.osmium >= 1;
+		case 'H': return r.life != SIM_MAX_ROVER_LIFE && r.osmium >= 1;
+		}
+		return false;
+	}
+
+	bool buy(int rover, char item)
+	{
+		auto &r = rovers[rover];
+		if (!canBuy(r, item)) { return false; }
+
+		auto upgrade = [&](int &level)
+		{
+			if (level == 1) { r.iron -= 3; }
+			else { r.iron -= 6; r.osmium -= 1; }
+			level++;
+		};
+
+		switch (std::toupper((unsigned char)item))
+		{
+		case 'S': upgrade(r.cameraLevel); break;
+		case 'A': upgrade(r.gunLevel); break;
+		case 'D': upgrade(r.drilLevel); break;
+		case 'M': upgrade(r.wheelLevel); break;
+		case 'R': r.iron -= 2; r.osmium -= 1; r.hasAntena = 1; break;
+		case 'B': r.iron -= 1; r.osmium -= 1; r.hasBatery = 1; break;
+		case 'H': r.osmium -= 1; r.life = std::min(r.life + 5, SIM_MAX_ROVER_LIFE); break;
+		}
+		return true;
+	}
+
+#pragma endregion
+
+	//a whole command line for the waiting rover, read like the server reads the c file:
+	//letters with whitespace skipped, moves only before any action, buying ends the actions
+	void applyCommands(const char *commands)
+	{
+		if (rovers.empty() || !commands) { return; }
+
+		int w = waitingFor;
+		int movementsRemaining = rovers[w].wheelLevel;
+		int miningRemaining = rovers[w].drilLevel;
+		bool didAction = 0;
+		bool didMine = 0;
+		int phaze = 0;
+
+		const char *at = commands;
+		auto next = [&](char &c)
+		{
+			while (*at && std::isspace((unsigned char)*at)) { at++; }
+			if (!*at) { return false; }
+			c = *at++;
+			return true;
+		};
+
+		char c = 0;
+		while (next(c))
+		{
+			switch (std::toupper((unsigned char)c))
+			{
+			case 'U': case 'D': case 'L': case 'R':
+			if (phaze == 0 && movementsRemaining)
+			{
+				move(w, c);
+				movementsRemaining--;
+			}
+			break;
+
+			case 'A':
+			if ((phaze == 0 || phaze == 1) && !didAction)
+			{
+				phaze = 1;
+				didAction = 1;
+				if (next(c)) { attack(w, c); }
+			}
+			break;
+
+			case 'S':
+			if ((phaze == 0 || phaze == 1) && !didAction)
+			{
+				phaze = 1;
+				didAction = 1;
+				if (next(c)) { scan(w, c); }
+			}
+			break;
+
+			case 'M':
+			if ((phaze == 0 || phaze == 1) && (!didAction || didMine))
+			{
+				phaze = 1;
+				didAction = 1;
+				didMine = 1;
+
+				//out of drill the direction letter is not read, the server does the same
+				if (miningRemaining > 0)
+				{
+					if (next(c)) { mine(w, c); }
+				}
+				miningRemaining--;
+			}
+			break;
+
+			case 'P':
+			if (phaze == 0 || phaze == 1)
+			{
+				phaze = 1;
+				if (next(c)) { place(w, c); }
+			}
+			break;
+
+			case 'B':
+			phaze = 2;
+			if (next(c)) { buy(w, c); }
+			break;
+			}
+		}
+	}
+
+	//what the server does after a rover's turn: the next rover, the acid border, acid damage and deaths
+	void endTurn()
+	{
+		if (rovers.empty()) { return; }
+
+		rovers[waitingFor].currentRound++;
+
+		waitingFor = (waitingFor + 1) % rovers.size();
+
+		if (waitingFor == 0)
+		{
+			borderCulldown--;
+
+			if (borderCulldown <= 0)
+			{
+				borderCulldown = 2;
+
+				if (currentBorderAdvance < std::min(width, height) / 2 - 1)
+				{
+					for (int i = 0; i < width; i++)
+					{
+						set(i, currentBorderAdvance, 'F');
+						set(i, height - 1 - currentBorderAdvance, 'F');
+					}
+
+					for (int i = 0; i < height; i++)
+					{
+						set(currentBorderAdvance, i, 'F');
+						set(height - 1 - currentBorderAdvance, i, 'F');
+					}
+
+					currentBorderAdvance++;
+				}
+			}
+		}
+
+		//the server clears it once it wrote the next rover's file
+		rovers[waitingFor].scannedThisTurn = 0;
+
+		for (auto &r : rovers)
+		{
+			if (get(r.x, r.y) == 'F') { r.life--; }
+		}
+
+		for (int i = 0; i < (int)rovers.size(); i++)
+		{
+			if (rovers[i].life > 0) { continue; }
+
+			rovers.erase(rovers.begin() + i);
+
+			if (waitingFor > i)
+			{
+				waitingFor--;
+			}
+			else if (waitingFor == i && !rovers.empty())
+			{
+				waitingFor %= rovers.size();
+				rovers[waitingFor].scannedThisTurn = 0;
+			}
+
+			i--;
+		}
+
+		if (rovers.empty()) { waitingFor = 0; }
+	}
+
+	void step(const char *commands)
+	{
+		applyCommands(commands);
+		endTurn();
+	}
+};
@@ -0,0 +1,304 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+//Header only helpers shared by the bots, include it from the bot's .cpp.
+//Grids are flat, a cell is y * width + x.
+
+struct GridPoint
+{
+	int x = 0;
+	int y = 0;
+
+	GridPoint() {};
+	GridPoint(int x, int y):x(x), y(y) {};
+
+	bool operator==(const GridPoint &other) const { return x == other.x && y == other.y; }
+	bool operator!=(const GridPoint &other) const { return !(*this == other); }
+};
+
+//the 4 directions a rover can move in, same order as the U D L R commands
+static const int gridDirectionX[4] = {0, 0, -1, 1};
+static const int gridDirectionY[4] = {-1, 1, 0, 0};
+
+inline int manhattanDistance(GridPoint a, GridPoint b)
+{
+	return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+}
+
+//Binary min heap of cells with decrease key. The keys live outside, in the caller's arrays,
+//the heap only keeps where every cell sits so it can move it up when its key drops.
+struct CellHeap
+{
+	void reset(int cellCount)
+	{
+		heap.clear();
+		if ((int)position.size() != cellCount) { position.assign(cellCount, -1); }
+	}
+
+	bool empty() const { return heap.empty(); }
+	bool contains(int cell) const { return position[cell] >= 0; }
+
+	//key and tie are read from the arrays on every compare, smaller first
+	template<class LESS>
+	void push(int cell, LESS less)
+	{
+		position[cell] = heap.size();
+		heap.push_back(cell);
+		moveUp(heap.size() - 1, less);
+	}
+
+	template<class LESS>
+	void decreased(int cell, LESS less)
+	{
+		moveUp(position[cell], less);
+	}
+
+	template<class LESS>
+	int pop(LESS less)
+	{
+		int top = heap[0];
+		position[top] = -1;
+
+		int last = heap.back();
+		heap.pop_back();
+
+		if (!heap.empty())
+		{
+			heap[0] = last;
+			position[last] = 0;
+			moveDown(0, less);
+		}
+
+		return top;
+	}
+
+	//the cell's key went up or down
+	template<class LESS>
+	void changed(int cell, LESS less)
+	{
+		int i = position[cell];
+		moveUp(i, less);
+		moveDown(position[cell], less);
+	}
+
+	template<class LESS>
+	void remove(int cell, LESS less)
+	{
+		int i = position[cell];
+		position[cell] = -1;
+
+		int last = heap.back();
+		heap.pop_back();
+		if (i == (int)heap.size()) { return; }
+
+		heap[i] = last;
+		position[last] = i;
+		moveUp(i, less);
+		moveDown(position[last], less);
+	}
+
+	int top() const { return heap[0]; }
+
+	//cells still in the heap are unmarked so the next reset is O(heap)
+	void clear()
+	{
+		for (int c : heap) { position[c] = -1; }
+		heap.clear();
+	}
+
+private:
+	template<class LESS>
+	void moveUp(int i, LESS less)
+	{
+		int cell = heap[i];
+		while (i > 0)
+		{
+			int parent = (i - 1) / 2;
+			if (!less(cell, heap[parent])) { break; }
+			heap[i] = heap[parent];
+			position[heap[i]] = i;
+			i = parent;
+		}
+		heap[i] = cell;
+		position[cell] = i;
+	}
+
+	template<class LESS>
+	void moveDown(int i, LESS less)
+	{
+		int cell = heap[i];
+		int size = heap.size();
+		while (true)
+		{
+			int child = i * 2 + 1;
+			if (child >= size) { break; }
+			if (child + 1 < size && less(heap[child + 1], heap[child])) { child++; }
+			if (!less(heap[child], cell)) { break; }
+			heap[i] = heap[child];
+			position[heap[i]] = i;
+			i = child;
+		}
+		heap[i] = cell;
+		position[cell] = i;
+	}
+
+	std::vector<int> heap;
+	std::vector<int> position; //-1 when not in the heap
+};
+
+//the cells a rover can stand on, shared by the pathfinders
+struct PassableGrid
+{
+	int width = 0;
+	int height = 0;
+
+	//non zero where a rover can stand, fill it before searching
+	std::vector<unsigned char> passable;
+
+	bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+	bool isPassable(int x, int y) const { return inside(x, y) && passable[y * width + x]; }
+};
+
+//Per cell search data that is only valid where its stamp equals the query's generation,
+//so starting a query is just incrementing the generation instead of clearing.
+struct SearchStamps
+{
+	std::vector<uint32_t> seen;   //the search wrote the cell's data
+	std::vector<uint32_t> closed; //expanded
+	uint32_t generation = 0;
+
+	void resize(int cells)
+	{
+		seen.assign(cells, 0);
+		closed.assign(cells, 0);
+		generation = 0;
+	}
+
+	void next()
+	{
+		generation++;
+		if (generation == 0)
+		{
+			//wrapped around, old stamps could look current
+			std::fill(seen.begin(), seen.end(), 0);
+			std::fill(closed.begin(), closed.end(), 0);
+			generation = 1;
+		}
+	}
+
+	bool isSeen(int cell) const { return seen[cell] == generation; }
+	bool isClosed(int cell) const { return closed[cell] == generation; }
+	void markSeen(int cell) { seen[cell] = generation; }
+	void markClosed(int cell) { closed[cell] = generation; }
+};
+
+//A* on a 4-connected grid where every step costs 1. Nothing is allocated per query.
+struct GridPathfinder: PassableGrid
+{
+	//cells taken off the open list by the last query, for profiling
+	int expandedNodes = 0;
+
+	void resize(int w, int h)
+	{
+		if (w == width && h == height) { return; }
+		width = w;
+		height = h;
+
+		int cells = w * h;
+		passable.assign(cells, 1);
+		g.assign(cells, 0);
+		f.assign(cells, 0);
+		parent.assign(cells, -1);
+		stamps.resize(cells);
+	}
+
+	//path goes from start to target, both included. Returns false if the target can't be reached
+	bool findPath(GridPoint start, GridPoint target, std::vector<GridPoint> &path)
+	{
+		path.clear();
+		expandedNodes = 0;
+
+		if (!inside(start.x, start.y) || !isPassable(target.x, target.y)) { return false; }
+
+		stamps.next();
+
+		int startCell = start.y * width + start.x;
+		int targetCell = target.y * width + target.x;
+
+		//lower f first, on ties the deeper node, it is closer to the target
+		auto less = [&](int a, int b)
+		{
+			if (f[a] != f[b]) { return f[a] < f[b]; }
+			return g[a] > g[b];
+		};
+
+		open.reset(width * height);
+
+		g[startCell] = 0;
+		f[startCell] = manhattanDistance(start, target);
+		parent[startCell] = -1;
+		stamps.markSeen(startCell);
+		open.push(startCell, less);
+
+		while (!open.empty())
+		{
+			int cell = open.pop(less);
+			stamps.markClosed(cell);
+			expandedNodes++;
+
+			if (cell == targetCell)
+			{
+				for (int c = cell; c != -1; c = parent[c])
+				{
+					path.push_back({c % width, c / width});
+				}
+				std::reverse(path.begin(), path.end());
+				open.clear();
+				return true;
+			}
+
+			int x = cell % width;
+			int y = cell / width;
+
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + gridDirectionX[d];
+				int ny = y + gridDirectionY[d];
+				if (!isPassable(nx, ny)) { continue; }
+
+				int next = ny * width + nx;
+				if (stamps.isClosed(next)) { continue; }
+
+				int newG = g[cell] + 1;
+
+				if (!stamps.isSeen(next))
+				{
+					stamps.markSeen(next);
+					g[next] = newG;
+					f[next] = newG + manhattanDistance({nx, ny}, target);
+					parent[next] = cell;
+					open.push(next, less);
+				}
+				else if (newG < g[next])
+				{
+					f[next] -= g[next] - newG;
+					g[next] = newG;
+					parent[next] = cell;
+					open.decreased(next, less);
+				}
+			}
+		}
+
+		return false;
+	}
+
+private:
+	std::vector<int> g;
+	std::vector<int> f;
+	std::vector<int> parent;
+	SearchStamps stamps;
+	CellHeap open;
+};
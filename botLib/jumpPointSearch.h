@@ -0,0 +1,201 @@
+#pragma once
+#include "gridPath.h"
+
+//Jump point search for the 4-connected grid, same interface as GridPathfinder.
+//
+//Of all the shortest paths it only looks at the ones that turn vertical as early as
+//possible: a vertical step may only follow a horizontal one when the cell diagonally
+//behind is blocked, otherwise going vertical one cell earlier is just as short.
+//So a horizontal scan only stops at such forced turns, a vertical scan stops where one
+//of its horizontal scans would stop, and only the cells where the path can turn ever
+//go on the open list. On open maps that is a few nodes instead of the whole area.
+struct JumpPointPathfinder: PassableGrid
+{
+	//jump points taken off the open list by the last query, for profiling
+	int expandedNodes = 0;
+
+	void resize(int w, int h)
+	{
+		if (w == width && h == height) { return; }
+		width = w;
+		height = h;
+
+		int cells = w * h;
+		passable.assign(cells, 1);
+		g.assign(cells, 0);
+		f.assign(cells, 0);
+		parent.assign(cells, -1);
+		stamps.resize(cells);
+	}
+
+	//path goes from start to target, both included, every cell of it not only the jump points.
+	//Returns false if the target can't be reached
+	bool findPath(GridPoint start, GridPoint target, std::vector<GridPoint> &path)
+	{
+		path.clear();
+		expandedNodes = 0;
+
+		if (!inside(start.x, start.y) || !isPassable(target.x, target.y)) { return false; }
+
+		stamps.next();
+		this->target = target;
+
+		int startCell = start.y * width + start.x;
+		int targetCell = target.y * width + target.x;
+
+		auto less = [&](int a, int b)
+		{
+			if (f[a] != f[b]) { return f[a] < f[b]; }
+			return g[a] > g[b];
+		};
+
+		open.reset(width * height);
+
+		g[startCell] = 0;
+		f[startCell] = manhattanDistance(start, target);
+		parent[startCell] = -1;
+		stamps.markSeen(startCell);
+		open.push(startCell, less);
+
+		while (!open.empty())
+		{
+			int cell = open.pop(less);
+			stamps.markClosed(cell);
+			expandedNodes++;
+
+			if (cell == targetCell)
+			{
+				buildPath(cell, path);
+				open.clear();
+				return true;
+			}
+
+			GridPoint p = {cell % width, cell / width};
+
+			//the direction the node was reached in, none for the start
+			int dx = 0;
+			int dy = 0;
+			if (parent[cell] != -1)
+			{
+				int px = parent[cell] % width;
+				int py = parent[cell] / width;
+				dx = (p.x > px) - (p.x < px);
+				dy = (p.y > py) - (p.y < py);
+			}
+
+			for (int d = 0; d < 4; d++)
+			{
+				int ndx = gridDirectionX[d];
+				int ndy = gridDirectionY[d];
+
+				if (dx || dy)
+				{
+					//never back
+					if (ndx == -dx && ndy == -dy) { continue; }
+
+					//after a horizontal step, vertical only if it is forced
+					if (dx && ndy && (!isPassable(p.x, p.y + ndy) || isPassable(p.x - dx, p.y + ndy)))
+					{
+						continue;
+					}
+				}
+
+				GridPoint jumpPoint;
+				if (!jump(p, ndx, ndy, jumpPoint)) { continue; }
+
+				int next = jumpPoint.y * width + jumpPoint.x;
+				if (stamps.isClosed(next)) { continue; }
+
+				int newG = g[cell] + manhattanDistance(p, jumpPoint);
+
+				if (!stamps.isSeen(next))
+				{
+					stamps.markSeen(next);
+					g[next] = newG;
+					f[next] = newG + manhattanDistance(jumpPoint, target);
+					parent[next] = cell;
+					open.push(next, less);
+				}
+				else if (newG < g[next])
+				{
+					f[next] -= g[next] - newG;
+					g[next] = newG;
+					parent[next] = cell;
+					open.decreased(next, less);
+				}
+			}
+		}
+
+		return false;
+	}
+
+private:
+	bool jump(GridPoint from, int dx, int dy, GridPoint &result)
+	{
+		if (dx) { return jumpHorizontal(from, dx, result); }
+
+		int x = from.x;
+		int y = from.y;
+		GridPoint ignored;
+
+		while (true)
+		{
+			y += dy;
+			if (!isPassable(x, y)) { return false; }
+
+			if ((x == target.x && y == target.y)
+				|| jumpHorizontal({x, y}, 1, ignored)
+				|| jumpHorizontal({x, y}, -1, ignored))
+			{
+				result = {x, y};
+				return true;
+			}
+		}
+	}
+
+	//stops on the target or where a vertical step becomes forced
+	bool jumpHorizontal(GridPoint from, int dx, GridPoint &result)
+	{
+		int x = from.x;
+		int y = from.y;
+
+		while (true)
+		{
+			x += dx;
+			if (!isPassable(x, y)) { return false; }
+
+			if ((x == target.x && y == target.y)
+				|| (isPassable(x, y - 1) && !isPassable(x - dx, y - 1))
+				|| (isPassable(x, y + 1) && !isPassable(x - dx, y + 1)))
+			{
+				result = {x, y};
+				return true;
+			}
+		}
+	}
+
+	//jump points are on straight lines from their parents, fill in the cells between
+	void buildPath(int cell, std::vector<GridPoint> &path)
+	{
+		int c = cell;
+		for (; parent[c] != -1; c = parent[c])
+		{
+			GridPoint p = {c % width, c / width};
+			GridPoint from = {parent[c] % width, parent[c] / width};
+			int dx = (from.x > p.x) - (from.x < p.x);
+			int dy = (from.y > p.y) - (from.y < p.y);
+
+			for (; p != from; p.x += dx, p.y += dy) { path.push_back(p); }
+		}
+
+		path.push_back({c % width, c / width}); //the start
+		std::reverse(path.begin(), path.end());
+	}
+
+	GridPoint target;
+	std::vector<int> g;
+	std::vector<int> f;
+	std::vector<int> parent;
+	SearchStamps stamps;
+	CellHeap open;
+};
@@ -0,0 +1,245 @@
+#pragma once
+#include "gridPath.h"
+#include <string>
+
+//how a rover gets through a cell
+enum MiningTileKind: unsigned char
+{
+	MiningOpen = 0, //walk in
+	MiningRock,     //mine it first, then walk in
+	MiningWall,     //never
+};
+
+//server file tiles, fog and rovers count as open
+inline MiningTileKind miningTileKind(char c)
+{
+	switch (c)
+	{
+	case 'X': case 'A': case 'C': case 'D': return MiningRock; //stone, cobble, iron, osmium
+	case 'B': return MiningWall;
+	default: return MiningOpen;
+	}
+}
+
+//one cell of a plan, turn counts from 0 for the turn being planned
+struct MiningStep
+{
+	GridPoint cell;
+	int turn = 0;      //the turn the rover drives into the cell
+	bool mined = 0;    //dug in the turn before, from the previous cell
+};
+
+//Plans routes that dig through rock, in turns rather than cells.
+//A turn is up to wheelLevel moves followed by the mining, and a mined cell can only be
+//entered the next turn, so the search counts time in moves: a walk is one move, digging
+//skips to the first move of the next turn. That keeps earlier always better, so A* with
+//Manhattan distance still finds the plan that arrives in the fewest turns.
+struct MiningPathfinder
+{
+	int width = 0;
+	int height = 0;
+
+	//MiningTileKind per cell, fill it before searching
+	std::vector<unsigned char> tiles;
+
+	//cells taken off the open list by the last query, for profiling
+	int expandedNodes = 0;
+
+	void resize(int w, int h)
+	{
+		if (w == width && h == height) { return; }
+		width = w;
+		height = h;
+
+		int cells = w * h;
+		tiles.assign(cells, MiningOpen);
+		time.assign(cells, 0);
+		f.assign(cells, 0);
+		parent.assign(cells, -1);
+		stamps.resize(cells);
+	}
+
+	bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+	MiningTileKind kind(int x, int y) const { return inside(x, y) ? (MiningTileKind)tiles[y * width + x] : MiningWall; }
+
+	//plan holds every cell after start up to target. Returns the turns it takes, -1 if it can't be done.
+	//Without a drill rock is a wall
+	int findPlan(GridPoint start, GridPoint target, int wheelLevel, int drilLevel, std::vector<MiningStep> &plan)
+	{
+		plan.clear();
+		expandedNodes = 0;
+
+		if (!inside(start.x, start.y) || kind(target.x, target.y) == MiningWall) { return -1; }
+		if (drilLevel < 1 && kind(target.x, target.y) == MiningRock) { return -1; }
+
+		int moves = std::max(wheelLevel, 1);
+
+		stamps.next();
+
+		int startCell = start.y * width + start.x;
+		int targetCell = target.y * width + target.x;
+
+		auto less = [&](int a, int b)
+		{
+			if (f[a] != f[b]) { return f[a] < f[b]; }
+			return time[a] > time[b];
+		};
+
+		open.reset(width * height);
+
+		time[startCell] = 0;
+		f[startCell] = manhattanDistance(start, target);
+		parent[startCell] = -1;
+		stamps.markSeen(startCell);
+		open.push(startCell, less);
+
+		while (!open.empty())
+		{
+			int cell = open.pop(less);
+			stamps.markClosed(cell);
+			expandedNodes++;
+
+			if (cell == targetCell)
+			{
+				buildPlan(cell, moves, plan);
+				open.clear();
+				return plan.empty() ? 0 : plan.back().turn + 1;
+			}
+
+			int x = cell % width;
+			int y = cell / width;
+
+			//the turn of the last move, the mining happens at its end
+			int turn = time[cell] > 0 ? (time[cell] - 1) / moves : 0;
+
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + gridDirectionX[d];
+				int ny = y + gridDirectionY[d];
+
+				int newTime = 0;
+				switch (kind(nx, ny))
+				{
+				case MiningOpen: newTime = time[cell] + 1; break;
+				case MiningRock:
+				if (drilLevel < 1) { continue; }
+				newTime = (turn + 1) * moves + 1;
+				break;
+				default: continue;
+				}
+
+				int next = ny * width + nx;
+				if (stamps.isClosed(next)) { continue; }
+
+				if (!stamps.isSeen(next))
+				{
+					stamps.markSeen(next);
+					time[next] = newTime;
+					f[next] = newTime + manhattanDistance({nx, ny}, target);
+					parent[next] = cell;
+					open.push(next, less);
+				}
+				else if (newTime < time[next])
+				{
+					f[next] -= time[next] - newTime;
+					time[next] = newTime;
+					parent[next] = cell;
+					open.decreased(next, less);
+				}
+			}
+		}
+
+		return -1;
+	}
+
+private:
+	void buildPlan(int cell, int moves, std::vector<MiningStep> &plan)
+	{
+		for (int c = cell; parent[c] != -1; c = parent[c])
+		{
+			MiningStep step;
+			step.cell = {c % width, c / width};
+			step.turn = (time[c] - 1) / moves;
+			step.mined = tiles[c] == MiningRock;
+			plan.push_back(step);
+		}
+		std::reverse(plan.begin(), plan.end());
+	}
+
+	std::vector<int> time; //moves since the start of the plan, turn boundaries included
+	std::vector<int> f;
+	std::vector<int> parent;
+	SearchStamps stamps;
+	CellHeap open;
+};
+
+//The turns for driving along a path found some other way, digging the rock on it, by the same
+//rules as findPlan. path starts at the rover. Returns the turns it takes
+template<class IS_ROCK>
+int planAlongPath(const std::vector<GridPoint> &path, int wheelLevel, IS_ROCK isRock, std::vector<MiningStep> &plan)
+{
+	plan.clear();
+	int moves = std::max(wheelLevel, 1);
+	int time = 0;
+
+	for (size_t i = 1; i < path.size(); i++)
+	{
+		MiningStep step;
+		step.cell = path[i];
+		step.mined = isRock(path[i].x, path[i].y);
+
+		if (step.mined)
+		{
+			int turn = time > 0 ? (time - 1) / moves : 0;
+			time = (turn + 1) * moves + 1;
+		}
+		else
+		{
+			time++;
+		}
+
+		step.turn = (time - 1) / moves;
+		plan.push_back(step);
+	}
+
+	return plan.empty() ? 0 : plan.back().turn + 1;
+}
+
+//the U D L R letter of a step between two neighbors
+inline char gridDirectionLetter(GridPoint from, GridPoint to)
+{
+	if (to.y < from.y) { return 'U'; }
+	if (to.y > from.y) { return 'D'; }
+	if (to.x < from.x) { return 'L'; }
+	return 'R';
+}
+
+//what to send for the first turn of a plan: its moves, then the mining, like "R R M U"
+inline std::string firstTurnCommands(GridPoint start, const std::vector<MiningStep> &plan)
+{
+	std::string commands;
+	GridPoint at = start;
+
+	for (auto &step : plan)
+	{
+		if (step.mined)
+		{
+			//the dig happens the turn before the rover drives in
+			if (step.turn - 1 == 0)
+			{
+				if (!commands.empty()) { commands += ' '; }
+				commands += "M ";
+				commands += gridDirectionLetter(at, step.cell);
+			}
+			break;
+		}
+
+		if (step.turn != 0) { break; }
+
+		if (!commands.empty()) { commands += ' '; }
+		commands += gridDirectionLetter(at, step.cell);
+		at = step.cell;
+	}
+
+	return commands;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+//What a bot remembers of the map, one byte per cell. Every turn's view is merged in:
+//cells seen this turn are overwritten, cells in the fog ('?') keep what was known.
+struct TerrainKnowledge
+{
+	int width = 0;
+	int height = 0;
+
+	std::vector<char> tiles;         //'?' for cells never seen
+	std::vector<int32_t> lastSeen;   //round the cell was last seen in, -1 never
+	std::vector<int> changed;        //cells whose tile changed in the last observe, all of them after a resize
+
+	static constexpr char UNKNOWN = '?';
+
+	void resize(int w, int h)
+	{
+		if (w == width && h == height) { return; }
+		width = w;
+		height = h;
+		tiles.assign(w * h, UNKNOWN);
+		lastSeen.assign(w * h, -1);
+
+		changed.resize(w * h);
+		for (int i = 0; i < w * h; i++) { changed[i] = i; }
+	}
+
+	bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+
+	char get(int x, int y) const { return inside(x, y) ? tiles[y * width + x] : UNKNOWN; }
+
+	//bedrock can't be mined, once seen it stays a wall
+	bool isBedrock(int x, int y) const { return get(x, y) == 'B'; }
+
+	static bool isPlayer(char c) { return c >= '0' && c <= '9'; }
+
+	//grid is the view from the server file, grid[y][x]. Returns how many bedrock cells were new
+	int observe(const std::vector<std::vector<char>> &grid, int round)
+	{
+		int h = grid.size();
+		int w = h ? grid[0].size() : 0;
+
+		bool resized = w != width || h != height;
+		if (!resized) { changed.clear(); }
+		resize(w, h);
+
+		int newBedrock = 0;
+
+		for (int y = 0; y < h; y++)
+		{
+			int rowSize = grid[y].size();
+			for (int x = 0; x < w && x < rowSize; x++)
+			{
+				char c = grid[y][x];
+				if (c == UNKNOWN) { continue; }
+
+				int cell = y * w + x;
+				char &known = tiles[cell];
+
+				char before = known;
+
+				if (isPlayer(c))
+				{
+					//a rover stands on something walkable, keep it if we know which
+					if (known != '.' && known != 'E' && known != 'F') { known = '.'; }
+				}
+				else
+				{
+					if (c == 'B' && known != 'B') { newBedrock++; }
+					known = c;
+				}
+
+				if (known != before && !resized) { changed.push_back(cell); }
+
+				lastSeen[cell] = round;
+			}
+		}
+
+		return newBedrock;
+	}
+};
@@ -0,0 +1,272 @@
+#pragma once
+#include "forwardModel.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//A whole turn packed in 32 bits, for search bots that go through thousands of them a second:
+//bits 0-1   how many moves
+//bits 2-7   the moves, 2 bits each, in turnDirectionLetters order
+//bits 8-10  the TurnAction
+//bits 11-14 mining: one bit per direction. Other actions: the direction in bits 11-12
+//bits 15-17 what is bought, an index in turnBuyLetters, 0 for nothing
+typedef uint32_t TurnCode;
+
+enum TurnAction: unsigned
+{
+	TurnNoAction = 0,
+	TurnMine,
+	TurnPlace,
+	TurnAttack,
+	TurnScan,
+};
+
+static const char turnDirectionLetters[4] = {'U', 'D', 'L', 'R'};
+static const int turnDirectionX[4] = {0, 0, -1, 1};
+static const int turnDirectionY[4] = {-1, 1, 0, 0};
+
+static const char turnBuyLetters[8] = {0, 'S', 'A', 'D', 'M', 'R', 'B', 'H'};
+
+inline int turnMoveCount(TurnCode code) { return code & 3; }
+inline int turnMove(TurnCode code, int i) { return (code >> (2 + 2 * i)) & 3; }
+inline TurnAction turnAction(TurnCode code) { return (TurnAction)((code >> 8) & 7); }
+inline int turnMineMask(TurnCode code) { return (code >> 11) & 15; }
+inline int turnActionDirection(TurnCode code) { return (code >> 11) & 3; }
+inline int turnBuy(TurnCode code) { return (code >> 15) & 7; }
+
+//one more move at the end
+inline TurnCode withMove(TurnCode code, int direction)
+{
+	int count = turnMoveCount(code);
+	return (code + 1) | ((TurnCode)direction << (2 + 2 * count));
+}
+
+//directions is the mining mask or one direction
+inline TurnCode withAction(TurnCode code, TurnAction action, int directions)
+{
+	return code | ((TurnCode)action << 8) | ((TurnCode)directions << 11);
+}
+
+inline TurnCode withBuy(TurnCode code, int item)
+{
+	return code | ((TurnCode)item << 15);
+}
+
+//where the moves end, without checking them
+inline void turnEndCell(TurnCode code, int x, int y, int &endX, int &endY)
+{
+	endX = x;
+	endY = y;
+	for (int i = 0; i < turnMoveCount(code); i++)
+	{
+		endX += turnDirectionX[turnMove(code, i)];
+		endY += turnDirectionY[turnMove(code, i)];
+	}
+}
+
+//the line to write in the c file, like "U R M L M D B H"
+inline std::string turnCommands(TurnCode code)
+{
+	std::string commands;
+	auto add = [&](char c)
+	{
+		if (!commands.empty()) { commands += ' '; }
+		commands += c;
+	};
+
+	for (int i = 0; i < turnMoveCount(code); i++)
+	{
+		add(turnDirectionLetters[turnMove(code, i)]);
+	}
+
+	switch (turnAction(code))
+	{
+	case TurnMine:
+	for (int d = 0; d < 4; d++)
+	{
+		if (turnMineMask(code) & (1 << d))
+		{
+			add('M');
+			add(turnDirectionLetters[d]);
+		}
+	}
+	break;
+	case TurnPlace: add('P'); add(turnDirectionLetters[turnActionDirection(code)]); break;
+	case TurnAttack: add('A'); add(turnDirectionLetters[turnActionDirection(code)]); break;
+	case TurnScan: add('S'); add(turnDirectionLetters[turnActionDirection(code)]); break;
+	default: break;
+	}
+
+	if (turnBuy(code))
+	{
+		add('B');
+		add(turnBuyLetters[turnBuy(code)]);
+	}
+
+	return commands;
+}
+
+//Plays a turn from legalTurns on the state without going through the command text.
+//Does what applyCommands(turnCommands(code)) does, the turn still has to be ended
+inline void applyTurn(SimState &s, int rover, TurnCode code)
+{
+	for (int i = 0; i < turnMoveCount(code); i++)
+	{
+		s.move(rover, turnDirectionLetters[turnMove(code, i)]);
+	}
+
+	char direction = turnDirectionLetters[turnActionDirection(code)];
+	switch (turnAction(code))
+	{
+	case TurnMine:
+	for (int d = 0; d < 4; d++)
+	{
+		if (turnMineMask(code) & (1 << d)) { s.mine(rover, turnDirectionLetters[d]); }
+	}
+	break;
+	case TurnPlace: s.place(rover, direction); break;
+	case TurnAttack: s.attack(rover, direction); break;
+	case TurnScan: s.scan(rover, direction); break;
+	default: break;
+	}
+
+	if (turnBuy(code)) { s.buy(rover, turnBuyLetters[turnBuy(code)]); }
+}
+
+//Every turn the rover can play that does something different, a single buy at most.
+//Left out because they do the same as one that is kept or nothing at all:
+//moves into walls or rovers, other ways to the same cell (nothing happens on the way),
+//mining air or mining the same cell twice, placing where it can't, attacks that hit nobody,
+//scans without an antenna and buys it can't pay after the moves and the mining.
+//Placing is listed as the turn's action. The server also takes places next to another
+//action, those turns are not listed.
+//Without withBuys only the moves and the action are listed, for bots that buy by a rule
+inline void legalTurns(const SimState &s, int rover, std::vector<TurnCode> &out, bool withBuys = true)
+{
+	out.clear();
+	if (rover < 0 || rover >= (int)s.rovers.size()) { return; }
+
+	const SimRover &r = s.rovers[rover];
+	int reach = std::min(std::max(r.wheelLevel, 0), 3);
+
+	//end cells in a 7x7 box around the rover, found breadth first so every one is
+	//reached with the fewest moves
+	struct Reached
+	{
+		int x, y;
+		TurnCode moves;
+	};
+	Reached reached[49];
+	bool seen[49] = {};
+	int reachedCount = 0;
+
+	reached[reachedCount++] = {r.x, r.y, 0};
+	seen[3 * 7 + 3] = 1;
+
+	for (int i = 0; i < reachedCount; i++)
+	{
+		if (turnMoveCount(reached[i].moves) >= reach) { continue; }
+
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = reached[i].x + turnDirectionX[d];
+			int ny = reached[i].y + turnDirectionY[d];
+
+			int box = (ny - r.y + 3) * 7 + (nx - r.x + 3);
+			if (seen[box]) { continue; }
+			if (!s.inside(nx, ny) || !SimState::isOpen(s.get(nx, ny))) { continue; }
+			if (s.roverAt(nx, ny) >= 0) { continue; }
+
+			seen[box] = 1;
+			reached[reachedCount++] = {nx, ny, withMove(reached[i].moves, d)};
+		}
+	}
+
+	for (int i = 0; i < reachedCount; i++)
+	{
+		int x = reached[i].x;
+		int y = reached[i].y;
+
+		//another rover there, the moved rover is not where the state has it anymore
+		auto otherRover = [&](int cx, int cy)
+		{
+			int hit = s.roverAt(cx, cy);
+			return hit >= 0 && hit != rover;
+		};
+
+		auto add = [&](TurnCode code, int iron, int osmium)
+		{
+			out.push_back(code);
+			if (!withBuys) { return; }
+
+			SimRover after = r;
+			after.x = x;
+			after.y = y;
+			after.iron += iron;
+			after.osmium += osmium;
+
+			for (int item = 1; item < 8; item++)
+			{
+				if (SimState::canBuy(after, turnBuyLetters[item])) { out.push_back(withBuy(code, item)); }
+			}
+		};
+
+		TurnCode moves = reached[i].moves;
+		add(moves, 0, 0);
+
+		int minable = 0;
+		int placeable = 0;
+
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = x + turnDirectionX[d];
+			int ny = y + turnDirectionY[d];
+			if (!s.inside(nx, ny)) { continue; }
+
+			char tile = s.get(nx, ny);
+			if (SimState::isMinable(tile)) { minable |= 1 << d; }
+			if (tile == '.' && !otherRover(nx, ny) && r.stones > 0) { placeable |= 1 << d; }
+		}
+
+		//any set of the minable cells the drill can take in one turn
+		for (int mask = minable; mask; mask = (mask - 1) & minable)
+		{
+			int count = 0;
+			int iron = 0;
+			int osmium = 0;
+			for (int d = 0; d < 4; d++)
+			{
+				if (!(mask & (1 << d))) { continue; }
+				count++;
+				char tile = s.get(x + turnDirectionX[d], y + turnDirectionY[d]);
+				iron += tile == 'C';
+				osmium += tile == 'D';
+			}
+
+			if (count <= r.drilLevel) { add(withAction(moves, TurnMine, mask), iron, osmium); }
+		}
+
+		for (int d = 0; d < 4; d++)
+		{
+			if (placeable & (1 << d)) { add(withAction(moves, TurnPlace, d), 0, 0); }
+
+			//the bullet like SimState::attack flies it
+			int bx = x;
+			int by = y;
+			for (int j = 0; j < r.gunLevel; j++)
+			{
+				bx += turnDirectionX[d];
+				by += turnDirectionY[d];
+
+				if (otherRover(bx, by))
+				{
+					add(withAction(moves, TurnAttack, d), 0, 0);
+					break;
+				}
+				if (s.inside(bx, by) && !SimState::isOpen(s.get(bx, by))) { break; }
+			}
+
+			if (r.hasAntena) { add(withAction(moves, TurnScan, d), 0, 0); }
+		}
+	}
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+//Sleeps until the server's file for the next turn shows up instead of trying to open it in a loop.
+//On Linux inotify wakes the bot as soon as the server closes the file, on Windows a change
+//notification on the folder does. Anywhere else, or if the folder can't be watched, it checks
+//with a sleep that doubles from minBackoff to maxBackoff.
+//The server deletes and makes the game folder again when a game starts, the watch follows it.
+struct TurnWait
+{
+	//also how often it looks even with notifications, in case one was missed
+	int minBackoffMicroseconds = 100;
+	int maxBackoffMicroseconds = 20000;
+
+	TurnWait() {};
+	TurnWait(const TurnWait &other) = delete;
+	TurnWait &operator=(const TurnWait &other) = delete;
+	~TurnWait() { closeWatch(); }
+
+	//blocks until path exists. Returns true if the writer was seen closing it, so it is complete,
+	//false if it was already there or found by looking, then it may still be being written
+	bool wait(const std::string &path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		std::string folder = slash == std::string::npos ? "." : path.substr(0, slash);
+		std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+		int backoff = std::max(minBackoffMicroseconds, 1);
+
+		while (true)
+		{
+			//watch first, then look, so a file written in between is not missed.
+			//Does nothing while the watch is fine, makes it again if the folder was replaced
+			openWatch(folder);
+
+			if (exists(path)) { return false; }
+			if (waitForChange(name, backoff)) { return true; }
+
+			backoff = std::min(backoff * 2, std::max(maxBackoffMicroseconds, 1));
+		}
+	}
+
+private:
+	static bool exists(const std::string &path)
+	{
+		std::error_code error;
+		return std::filesystem::exists(path, error);
+	}
+
+	std::string watchedFolder;
+
+#if defined(__linux__)
+
+	int notify = -1;
+	int watch = -1;
+
+	void openWatch(const std::string &folder)
+	{
+		if (watch >= 0 && folder == watchedFolder) { return; }
+		closeWatch();
+
+		notify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		if (notify < 0) { return; }
+
+		watch = inotify_add_watch(notify, folder.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+		if (watch < 0) { closeWatch(); return; }
+		watchedFolder = folder;
+	}
+
+	void closeWatch()
+	{
+		if (notify >= 0) { ::close(notify); }
+		notify = -1;
+		watch = -1;
+		watchedFolder.clear();
+	}
+
+	//true if name was closed after writing or moved in.
+	//If the folder went away the watch is dropped, the next openWatch makes a new one
+	bool waitForChange(const std::string &name, int backoff)
+	{
+		if (notify < 0)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(backoff));
+			return false;
+		}
+
+		pollfd p = {};
+		p.fd = notify;
+		p.events = POLLIN;
+		if (poll(&p, 1, std::max(backoff / 1000, 1)) <= 0) { return false; }
+
+		alignas(inotify_event) char buffer[4096];
+		bool found = false;
+		bool folderGone = false;
+
+		while (true)
+		{
+			ssize_t size = read(notify, buffer, sizeof(buffer));
+			if (size <= 0) { break; }
+
+			for (char *at = buffer; at < buffer + size;)
+			{
+				auto event = (inotify_event *)at;
+				if (event->len && name == event->name) { found = true; }
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) { folderGone = true; }
+				at += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		if (folderGone) { closeWatch(); }
+		return found;
+	}
+
+#elif defined(_WIN32)
+
+	HANDLE notify = INVALID_HANDLE_VALUE;
+
+	void openWatch(const std::string &folder)
+	{
+		if (notify != INVALID_HANDLE_VALUE && folder == watchedFolder) { return; }
+		closeWatch();
+
+		notify = FindFirstChangeNotificationA(folder.c_str(), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+		if (notify != INVALID_HANDLE_VALUE) { watchedFolder = folder; }
+	}
+
+	void closeWatch()
+	{
+		if (notify != INVALID_HANDLE_VALUE) { FindCloseChangeNotification(notify); }
+		notify = INVALID_HANDLE_VALUE;
+		watchedFolder.clear();
+	}
+
+	//the notification doesn't say which file, the caller looks
+	bool waitForChange(const std::string &name, int backoff)
+	{
+		if (notify == INVALID_HANDLE_VALUE)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(backoff));
+			return false;
+		}
+
+		if (WaitForSingleObject(notify, std::max(backoff / 1000, 1)) == WAIT_OBJECT_0)
+		{
+			//fails once the folder is gone, the next openWatch makes a new one
+			if (!FindNextChangeNotification(notify)) { closeWatch(); }
+		}
+		return false;
+	}
+
+#else
+
+	void openWatch(const std::string &folder) {}
+	void closeWatch() {}
+
+	bool waitForChange(const std::string &name, int backoff)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(backoff));
+		return false;
+	}
+
+#endif
+};
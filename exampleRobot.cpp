@@ -2,6 +2,7 @@
 #include <fstream>
 #include <string>
 #include <thread>
+#include "botLib/turnWait.h"
 using namespace std;
 
 int main()
@@ -12,17 +13,22 @@ int main()
 
 	int round = 0;
 
+	TurnWait turnWait;
+
 	while (true)
 	{
 		std::string serverFileName = "game/s" + std::to_string(id) + "_" + std::to_string(round) + 
 			".txt";
 
+		//sleeps until the server writes it
+		bool complete = turnWait.wait(serverFileName);
+
 		std::ifstream input(serverFileName);
 
 		if (input)
 		{
 			//sleep a little to make sure that the file was written bt the server
-			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			if (!complete) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
 
 			//it is our turn to move
 			//read the file...
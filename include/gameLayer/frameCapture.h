@@ -0,0 +1,96 @@
+#pragma once
+#include <gl2d/gl2d.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdio>
+
+enum CaptureFormat
+{
+	CaptureY4M = 0, //one raw video file, 4:2:0
+	CapturePNG,     //a folder of numbered images
+};
+
+//Records a FrameBuffer without stalling the render loop. glReadPixels goes into a ring
+//of pixel buffer objects that is only mapped a few frames later when its fence signaled,
+//the pixels are then written to disk by a background thread.
+struct FrameCapture
+{
+	FrameCapture() {};
+	FrameCapture(const FrameCapture &other) = delete;
+	FrameCapture &operator=(const FrameCapture &other) = delete;
+	~FrameCapture() { stopEncoder(); } //the gl context may be gone by now, call cleanup before
+
+	//path is the .y4m file or the folder for the images. fps only goes in the y4m header
+	bool start(const std::string &path, CaptureFormat format, int framesPerTurn, int fps = 30);
+
+	//waits for the frames in flight and the encoder
+	void stop();
+
+	bool isRecording() { return recording; }
+
+	//the next frame read back is also saved as a png image, works without recording
+	void requestThumbnail(const std::string &path);
+
+	//call once per frame after the frame buffer was drawn. A new turn allows framesPerTurn more frames
+	void update(gl2d::FrameBuffer &frameBuffer, bool newTurn);
+
+	//releases the gl buffers and stops the encoder
+	void cleanup();
+
+	int capturedFrames = 0;
+	int droppedFrames = 0; //the encoder couldn't keep up
+	int framesPerTurn = 2;
+
+	static constexpr int PBO_COUNT = 3;
+	static constexpr int MAX_QUEUED_FRAMES = 16;
+
+private:
+	struct Frame
+	{
+		std::vector<unsigned char> rgba; //bottom row first, like opengl
+		glm::ivec2 size = {};
+		bool video = 0;
+		std::string thumbnailPath;
+	};
+
+	struct ReadBack
+	{
+		GLuint pbo = 0;
+		GLsync fence = 0;
+		glm::ivec2 size = {};
+		bool video = 0;
+		std::string thumbnailPath;
+	};
+
+	void collect(bool wait);
+	void startEncoder();
+	void stopEncoder();
+	void encode();
+	void writeFrame(Frame &frame);
+
+	ReadBack readBacks[PBO_COUNT];
+	int nextReadBack = 0;
+
+	bool recording = 0;
+	CaptureFormat format = CaptureY4M;
+	std::string path;
+	int fps = 30;
+	int framesLeft = 0;
+	std::string pendingThumbnail;
+
+	//encoder thread state
+	std::thread encoder;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Frame> queue;
+	bool encoderRunning = 0;
+	FILE *video = nullptr;
+	glm::ivec2 videoSize = {}; //the first frame decides it, the others are cropped or padded
+	int imageIndex = 0;
+	std::vector<unsigned char> yuv;
+	std::vector<unsigned char> rgb;
+};
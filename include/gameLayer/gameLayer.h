@@ -35,6 +35,12 @@ namespace platform
 	bool isFocused();
 	bool mouseMoved();
 
+	//keeps the main loop at full frame rate for a while, call it when something moves.
+	//Otherwise, with idle throttling on, the loop waits for events at a low frame rate
+	void requestFullFrameRate(float seconds = 0.5f);
+	void setIdleThrottling(bool throttle);
+	bool isIdleThrottling();
+
 	bool writeEntireFile(const char *name, void *buffer, size_t size);
 	bool readEntireFile(const char *name, void *buffer, size_t size);
 
@@ -0,0 +1,130 @@
+#pragma once
+#include <stuff.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+//what a generated world depends on, the same key always gives the same map
+struct WorldKey
+{
+	int seed = 0;
+	glm::ivec2 mazeSize = {};
+	bool fewerResources = 0;
+
+	bool operator==(const WorldKey &other) const
+	{
+		return seed == other.seed && mazeSize == other.mazeSize && fewerResources == other.fewerResources;
+	}
+};
+
+struct WorldKeyHash
+{
+	size_t operator()(const WorldKey &k) const
+	{
+		unsigned long long h = (unsigned int)k.seed;
+		h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)k.mazeSize.x;
+		h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)k.mazeSize.y;
+		h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)k.fewerResources;
+		return (size_t)(h ^ (h >> 29));
+	}
+};
+
+struct PregeneratedWorld
+{
+	Map map;
+	std::vector<glm::ivec2> spawnPoints; //bases in row order
+};
+
+//runs generate_world and collects the spawn points
+PregeneratedWorld pregenerateWorld(WorldKey key, int threads = 1);
+
+//runs generate_worlds, one whole world per thread (0 means use every core)
+std::vector<PregeneratedWorld> pregenerateWorlds(glm::ivec2 mazeSize, bool fewerResources,
+	const std::vector<int> &seeds, int threads = 0);
+
+//a whole file mapped read only in memory
+struct MappedFile
+{
+	MappedFile() {};
+	MappedFile(const MappedFile &other) = delete;
+	MappedFile &operator=(const MappedFile &other) = delete;
+	~MappedFile() { unmap(); }
+
+	const unsigned char *data = nullptr;
+	size_t size = 0;
+
+	bool map(const char *path);
+	void unmap();
+
+private:
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#endif
+};
+
+//Append only file of generated worlds. Every entry is a small header, the spawn list
+//and the tiles packed two per byte. The file is memory mapped and indexed once,
+//looking a world up only decodes that entry. Safe to use from several threads.
+//A file written by another mapGeneratorVersion counts as empty and is replaced on the next add.
+struct WorldArchive
+{
+	bool open(const std::string &path);
+	void close();
+
+	bool contains(WorldKey key);
+	bool find(WorldKey key, PregeneratedWorld &world);
+	bool add(WorldKey key, const PregeneratedWorld &world);
+
+	int getEntryCount();
+
+private:
+	void remap();
+	size_t indexEntry(size_t pos);
+
+	std::mutex mutex;
+	std::string path;
+	MappedFile file;
+	std::unordered_map<WorldKey, size_t, WorldKeyHash> index; //key -> entry offset in the file
+	size_t validEnd = 0; //a torn write after this gets overwritten by the next add
+};
+
+//fills a WorldArchive with worlds on a background thread
+struct WorldPregenerator
+{
+	WorldPregenerator() {};
+	WorldPregenerator(const WorldPregenerator &other) = delete;
+	WorldPregenerator &operator=(const WorldPregenerator &other) = delete;
+	~WorldPregenerator() { stop(); }
+
+	void start(WorldArchive *archive);
+	void stop();
+
+	//queues the world unless it is already stored or queued, cheap enough to call every frame.
+	//It is generated on one thread so the game keeps running
+	void request(WorldKey key);
+
+	//queues a range of worlds the player asked for, like the seeds of a tournament.
+	//They are generated a few at a time on every core, single requests still go first
+	void requestBatch(const std::vector<WorldKey> &keys);
+
+	//worlds queued or being generated
+	int getPendingCount();
+
+private:
+	void work();
+
+	WorldArchive *archive = nullptr;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<WorldKey> queue;
+	std::deque<WorldKey> batchQueue;
+	std::unordered_set<WorldKey, WorldKeyHash> pending;
+	bool running = 0;
+};
@@ -4,13 +4,57 @@
 #include <glm/glm.hpp>
 #include <FastNoiseSIMD.h>
 #include <vector>
-#include <stack>
 #include <stuff.h>
 
-enum MazeTiles
+enum MazeAlgorithm
 {
-	NotVisited = ' ',
-	Visited = 4,
+	MazeBacktracker = 0, //long winding corridors, the classic look of the game
+	MazeWilson,          //uniform spanning tree, more short dead ends
+	MazeEller,           //carved row by row, memory only depends on the width
 };
 
-struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources);
\ No newline at end of file
+//small seedable random generator (xorshift64* seeded with splitmix64).
+//every generation call owns its own one so worlds can be generated on many threads at once
+struct MapRng
+{
+	MapRng() {};
+	explicit MapRng(unsigned long long seed) { setSeed(seed); }
+
+	unsigned long long state = 0x9E3779B97F4A7C15ull;
+
+	void setSeed(unsigned long long seed)
+	{
+		unsigned long long z = seed + 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z = z ^ (z >> 31);
+		state = z ? z : 0x9E3779B97F4A7C15ull;
+	}
+
+	unsigned int next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (unsigned int)((state * 0x2545F4914F6CDD1Dull) >> 32);
+	}
+
+	//returns a number in [0, max)
+	int nextInt(int max)
+	{
+		return (int)(((unsigned long long)next() * (unsigned int)max) >> 32);
+	}
+};
+
+//Change it whenever generate_world makes different maps for the same arguments,
+//stored worlds (mapArchive) made by another version are thrown away
+static const unsigned int mapGeneratorVersion = 1;
+
+//threads splits the noise and compositing stages in row bands (0 means use every core).
+//tiledMaze carves the maze in parallel tiles, worth it only for very big maps
+struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources, int threads = 1, bool tiledMaze = false,
+	MazeAlgorithm mazeAlgorithm = MazeBacktracker);
+
+//generates one world per seed, spread across threads (0 means use every core)
+std::vector<struct Map> generate_worlds(glm::ivec2 maze_size, const std::vector<int> &seeds, bool fewerResources,
+	int threads = 0);
@@ -0,0 +1,22 @@
+#pragma once
+
+//Row kernels for the map generator compositing stages.
+//They work on contiguous rows and use the widest instruction set that
+//FastNoiseSIMD::GetSIMDLevel reports, so they keep up with the noise feeding them.
+namespace mapKernels
+{
+	//out[i] = in[i] >= threshold ? above : below
+	void thresholdRow(const float *in, char *out, int count, float threshold, char above, char below);
+
+	//out[i] = test[i] != ignore ? value[i] : ignore
+	void maskRow(const char *test, const char *value, char *out, int count, char ignore);
+
+	//out[i] = test[i] != ignore ? value[i] : out[i]
+	void additiveRow(const char *test, const char *value, char *out, int count, char ignore);
+
+	//out[i] = in[i] == zero ? one : zero
+	void invertRow(const char *in, char *out, int count, char zero, char one);
+
+	//name of the kernel set picked for this cpu
+	const char *getKernelName();
+};
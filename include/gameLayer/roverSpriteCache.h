@@ -0,0 +1,84 @@
+#pragma once
+#include <gl2d/gl2d.h>
+#include <stuff.h>
+#include <unordered_map>
+#include <vector>
+
+//everything that changes how a rover looks, apart from its life and position
+struct RoverLook
+{
+	unsigned int color = 0; //rgb8
+	unsigned char gunLevel = 0;
+	unsigned char drilLevel = 0;
+	unsigned char wheelLevel = 0;
+	unsigned char cameraLevel = 0;
+	bool hasAntena = 0;
+	bool hasBatery = 0;
+
+	RoverLook() {};
+	RoverLook(const Player &player);
+
+	bool operator==(const RoverLook &other) const
+	{
+		return color == other.color && gunLevel == other.gunLevel && drilLevel == other.drilLevel
+			&& wheelLevel == other.wheelLevel && cameraLevel == other.cameraLevel
+			&& hasAntena == other.hasAntena && hasBatery == other.hasBatery;
+	}
+};
+
+struct RoverLookHash
+{
+	size_t operator()(const RoverLook &l) const
+	{
+		unsigned long long h = l.color;
+		h = (h << 4) | (l.gunLevel & 0xF);
+		h = (h << 4) | (l.drilLevel & 0xF);
+		h = (h << 4) | (l.wheelLevel & 0xF);
+		h = (h << 4) | (l.cameraLevel & 0xF);
+		h = (h << 2) | (l.hasAntena << 1) | l.hasBatery;
+		h *= 0x9E3779B97F4A7C15ull;
+		return (size_t)(h ^ (h >> 29));
+	}
+};
+
+//Every rover look is drawn once from the rover atlas layers into a cell of an offscreen
+//texture, after that a rover is one quad plus its health bar. Cells are reused least
+//recently used first when the texture is full.
+struct RoverSpriteCache
+{
+	RoverSpriteCache() {};
+	RoverSpriteCache(const RoverSpriteCache &other) = delete;
+	RoverSpriteCache &operator=(const RoverSpriteCache &other) = delete;
+
+	//call after gl2d::init, the textures must outlive the cache
+	void create(gl2d::Texture &roverTexture, gl2d::TextureAtlasPadding &roverAtlas);
+	void cleanup();
+
+	bool isReady() { return frameBuffer.fbo != 0; }
+
+	//same result as renderRover, the health bar is drawn every time
+	void render(gl2d::Renderer2D &renderer, Player &player);
+
+	//looks drawn into the texture so far, for profiling
+	int composedCount = 0;
+
+	static constexpr int CELL_SIZE = 128;
+	static constexpr int CELLS_PER_ROW = 8;
+
+private:
+	int getCell(const RoverLook &look);
+	void compose(int cell, const RoverLook &look);
+	glm::vec4 cellTextureCoords(int cell);
+
+	gl2d::FrameBuffer frameBuffer;
+	gl2d::Renderer2D composer;
+	gl2d::Texture scratch; //one cell, for un-premultiplying
+	gl2d::ShaderProgram unpremultiplyShader = {};
+	gl2d::Texture *roverTexture = nullptr;
+	gl2d::TextureAtlasPadding *roverAtlas = nullptr;
+
+	std::unordered_map<RoverLook, int, RoverLookHash> cells; //look -> cell
+	std::vector<RoverLook> cellLooks;
+	std::vector<unsigned long long> cellLastUse;
+	unsigned long long useCounter = 0;
+};
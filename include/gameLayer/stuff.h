@@ -3,6 +3,30 @@
 #include <vector>
 #define MAX_ROVER_LIFE 15
 
+//what a zobrist key stands for
+enum ZobristKind
+{
+	ZobristTile,
+	ZobristRover,
+	ZobristGame,
+};
+
+//Zobrist keys are made from what, where and which value instead of read from tables,
+//so they don't depend on the map size and every build of the game gets the same ones
+inline unsigned long long zobristKey(ZobristKind kind, unsigned long long index, unsigned long long value)
+{
+	auto mix = [](unsigned long long z)
+	{
+		//splitmix64
+		z += 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	};
+
+	return mix(mix(mix(kind) ^ index) ^ value);
+}
+
 void renderRover(gl2d::Renderer2D &renderer,
 	gl2d::Texture &roverTexture, gl2d::TextureAtlasPadding &roverAtlas,
 	glm::vec2 pos, glm::vec3 color,
@@ -11,6 +35,9 @@ void renderRover(gl2d::Renderer2D &renderer,
 
 bool calculateView(glm::ivec2 playerPos, glm::ivec2 blockPos, int level);
 
+//how far a camera of this level sees, 0 means nothing
+float viewRadius(int level);
+
 struct Player
 {
 
@@ -42,6 +69,10 @@ struct Player
 	glm::ivec2 spawnPoint = {};
 
 	glm::vec3 color = Colors_White;
+
+	//zobrist hash of what the turns change, the key of every field xored together.
+	//Only a dozen numbers, so it is made when asked rather than kept up to date
+	unsigned long long hash() const;
 };
 
 void renderRover(gl2d::Renderer2D &renderer,
@@ -62,15 +93,58 @@ enum Tiles
 };
 
 
+//index of the tile in the sprites atlas
+int tileAtlasIndex(char tile);
+
+//things handed to the renderer vs skipped because they were off screen
+struct CullingStats
+{
+	int submitted = 0;
+	int culled = 0;
+};
+
+//does the rect (world pixels) intersect what the renderer's camera sees
+bool isRectVisible(gl2d::Renderer2D &renderer, glm::vec4 rect);
+
+//tiles of the map the camera sees, as min corner and max corner (exclusive), clamped to the map
+glm::ivec4 visibleTiles(gl2d::Renderer2D &renderer, glm::ivec2 mapSize, float tileSize = 100);
+
 struct Map
 {
 	std::vector<char> mapData;
 
 	glm::ivec2 size;
 
+	//writes done through set since the tilemap last uploaded this map,
+	//allDirty asks for the whole map (new maps or writes that skipped set)
+	std::vector<glm::ivec2> dirtyCells;
+	bool allDirty = 1;
+
+	//zobrist hash of the tiles, kept up to date by set. Only the game map uses it,
+	//rehash is called once where a map becomes the game map
+	unsigned long long hash = 0;
+
+	unsigned long long tileKey(int x, int y, char c)
+	{
+		return zobristKey(ZobristTile, x + y * size.x, (unsigned char)c);
+	}
+
+	void rehash()
+	{
+		hash = 0;
+		for (int y = 0; y < size.y; y++)
+		{
+			for (int x = 0; x < size.x; x++)
+			{
+				hash ^= tileKey(x, y, unsafeGet(x, y));
+			}
+		}
+	}
+
 	void create(glm::ivec2 size)
 	{
 		this->size = size;
+		allDirty = 1;
 	
 		mapData.clear();
 		mapData.resize(size.x * size.y, Air);
@@ -82,7 +156,6 @@ struct Map
 			unsafeGet(0, i) = Bedrock;
 			unsafeGet(size.x-1, i) = Bedrock;
 		}
-		
 	}
 	
 	char &unsafeGet(glm::ivec2 pos)
@@ -103,6 +176,18 @@ struct Map
 		}
 	}
 
+	//like unsafeGet(x, y) = c but remembers the cell for the tilemap and updates the hash
+	void set(int x, int y, char c)
+	{
+		char &t = unsafeGet(x, y);
+		if (t != c)
+		{
+			hash ^= tileKey(x, y, t) ^ tileKey(x, y, c);
+			t = c;
+			dirtyCells.push_back({x, y});
+		}
+	}
+
 	char getValue(glm::ivec2 pos)
 	{
 		return getValue(pos.x, pos.y);
@@ -130,6 +215,7 @@ struct Map
 	void blank(glm::ivec2 size, char element)
 	{
 		this->size = size;
+		allDirty = 1;
 		this->mapData.clear();
 		this->mapData.resize(size.x * size.y, element);
 	}
@@ -137,14 +223,8 @@ struct Map
 	struct Map clone()
 	{
 		struct Map c;
-		c.blank(this->size, ' ');
-		for (int y = 0; y < this->size.y; y++)
-		{
-			for (int x = 0; x < this->size.x; x++)
-			{
-				c.unsafeGet(x, y) = this->getValue(x, y);
-			}
-		}
+		c.size = this->size;
+		c.mapData = this->mapData;
 		return c;
 	}
 
@@ -169,7 +249,7 @@ struct Map
 
 	void render(gl2d::Renderer2D &renderer, gl2d::Texture &tiles,
 		gl2d::TextureAtlasPadding &tilesAtlas, bool simulateFog,
-		std::vector<int> viewLevel, std::vector<glm::ivec2> playerPos);
+		std::vector<int> viewLevel, std::vector<glm::ivec2> playerPos, CullingStats *stats = nullptr);
 
 
 };
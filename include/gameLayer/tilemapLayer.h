@@ -0,0 +1,71 @@
+#pragma once
+#include <gl2d/gl2d.h>
+#include <stuff.h>
+#include <vector>
+
+//Draws a whole Map with one quad. The tiles live in a texture of atlas indexes
+//that is only patched where the map changed (see Map::set), the fragment shader
+//picks the sprite and applies the fog. Under MINIMAP_ZOOM every tile is drawn
+//as one flat color, the average of its sprite.
+struct TilemapLayer
+{
+	TilemapLayer() {};
+	TilemapLayer(const TilemapLayer &other) = delete;
+	TilemapLayer &operator=(const TilemapLayer &other) = delete;
+
+	//call after gl2d::init, returns false if the shader didn't compile
+	bool create();
+	void cleanup();
+
+	bool isReady() { return tilesProgram.id != 0; }
+
+	//uploads the changes of the map, clears its dirty cells
+	void update(Map &map);
+
+	//flushes what the renderer has so far, then draws the visible part of the map
+	//under the renderer's camera. stats count tiles
+	void render(gl2d::Renderer2D &renderer, Map &map, gl2d::Texture &tiles,
+		gl2d::TextureAtlasPadding &tilesAtlas, bool simulateFog,
+		const std::vector<int> &viewLevel, const std::vector<glm::ivec2> &playerPos,
+		CullingStats *stats = nullptr);
+
+	static constexpr int MAX_FOG_PLAYERS = 8;
+
+	//a tile is 100 units, under this zoom it is only a few pixels wide
+	static constexpr float MINIMAP_ZOOM = 0.1f;
+
+	static bool isMinimapZoom(gl2d::Renderer2D &renderer) { return renderer.currentCamera.zoom < MINIMAP_ZOOM; }
+
+private:
+	struct Program
+	{
+		GLuint id = 0;
+		GLint u_screenRect = -1;
+		GLint u_mapRect = -1;
+		GLint u_sampler = -1;
+		GLint u_tiles = -1;
+		GLint u_atlasRects = -1;
+		GLint u_tileColors = -1;
+		GLint u_fog = -1;
+		GLint u_playerCount = -1;
+		GLint u_playerPos = -1;
+		GLint u_viewRadius = -1;
+
+		bool create(const char *fragmentShader);
+	};
+
+	//averages every sprite of the atlas, once per texture
+	void updateTileColors(gl2d::Texture &tiles, gl2d::TextureAtlasPadding &tilesAtlas);
+
+	Program tilesProgram;
+	Program minimapProgram;
+	GLuint vao = 0;
+	GLuint vbo = 0;
+	GLuint tileTexture = 0;
+	glm::ivec2 textureSize = {};
+
+	GLuint tileColorsTexture = 0; //the tiles texture tileColors was computed from
+	glm::vec4 tileColors[10] = {};
+
+	std::vector<unsigned char> uploadBuffer;
+};
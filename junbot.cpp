@@ -6,6 +6,11 @@
 #include <vector>
 #include <queue>
 #include <algorithm> 
+#include "botLib/distanceField.h"
+#include "botLib/dStarLite.h"
+#include "botLib/turnWait.h"
+#include "botLib/miningPath.h"
+#include "botLib/terrainKnowledge.h"
 using namespace std;
 
 
@@ -28,102 +33,113 @@ struct location {
 
 location previousPosition(-1, -1);//default previousPosition location
 
-vector<location> bedrockBlacklist; //keeping track of bedrock
-
-//for f cost, g cost, and h cost
-struct Node {
-	location pos;
-	int f, g, h;
-
-	Node(location _pos, int _g, int _h) : pos(_pos), g(_g), h(_h), f(_g + _h) {}
-
-	bool operator>(const Node& other) const {
-		return f > other.f;
-	}
-};
+TerrainKnowledge knowledge; //everything seen so far, bedrock stays known once seen
 
 //using Manhattan heuristic, less turns and stuff
 int calculateHeuristic(location current, location target) {
 	return abs(current.x - target.x) + abs(current.y - target.y);
 }
 
-//checking validity of neighbor nodes, target nodes, nodes in the way of path.
-bool isValid(int x, int y, vector<vector<char>>& grid) {
-	if (x < 0 || x >= grid.size() || y < 0 || y >= grid[0].size()) {
-		return false;
-	}
-
-	for (auto& blacklisted : bedrockBlacklist) {
-		if (location(x, y) == blacklisted) {
-			return false;
-		}
-	}
+//bedrock ever seen and acid in view are walls, computed once per turn so queries look cells up in O(1)
+PassableGrid walkable;
 
-	return grid[y][x] != 'B' && grid[y][x] != 'F';
-}
+//steps from the rover to every cell it can reach this turn, targets are picked from it
+DistanceField field;
 
-//checking neighbors for next move, also preventing from going to previous position to prevent oscillation
-vector<location> getNeighbors(location current, vector<vector<char>>& grid, int id) {
-	vector<location> neighbors;
-	neighbors.emplace_back(current.x - 1, current.y);
-	neighbors.emplace_back(current.x + 1, current.y);
-	neighbors.emplace_back(current.x, current.y - 1);
-	neighbors.emplace_back(current.x, current.y + 1);
+//kept across turns, only the cells that changed since the last turn are searched again
+IncrementalPathfinder router;
+vector<MiningStep> plan;
 
+void updatePassable(vector<vector<char>>& grid) {
+	int height = grid.size();
+	int width = height ? grid[0].size() : 0;
+	walkable.width = width;
+	walkable.height = height;
+	walkable.passable.assign(width * height, 0);
 
-	vector<location> validNeighbors;
-	for (auto& neighbor : neighbors) {
-		if (isValid(neighbor.x, neighbor.y, grid) && !(neighbor == previousPosition)) {
-			validNeighbors.push_back(neighbor);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			char c = x < (int)grid[y].size() ? grid[y][x] : 'B';
+			walkable.passable[y * width + x] = c != 'B' && c != 'F' && !knowledge.isBedrock(x, y);
 		}
 	}
-
-	return validNeighbors;
 }
 
-//A* pathfinding
-vector<location> pathFind(location start, location target, vector<vector<char>>& grid, int id) {
+//a step into rock waits for the dig, about a turn of moves. Unknown cells are hoped to be open
+int routeCost(char tile, int wheelLevel, int drilLevel) {
+	if (tile == 'F') {
+		return IncrementalPathfinder::WALL;
+	}
+	switch (miningTileKind(tile)) {
+	case MiningOpen: return 1;
+	case MiningRock: return drilLevel > 0 ? max(wheelLevel, 1) : IncrementalPathfinder::WALL;
+	default: return IncrementalPathfinder::WALL;
+	}
+}
 
-	priority_queue<Node, vector<Node>, greater<Node>> openSet;
-	vector<vector<bool>> closedSet(mapSize, vector<bool>(mapSize, false));
-	vector<vector<Node>> nodeInfo(mapSize, vector<Node>(mapSize, Node(location(-1, -1), -1, -1)));
+//only the cells the last observation changed, all of them when the map or the levels change
+void updateRouteCosts(int wheelLevel, int drilLevel) {
+	static int lastWheelLevel = -1;
+	static int lastDrilLevel = -1;
+
+	bool all = router.width != knowledge.width || router.height != knowledge.height
+		|| wheelLevel != lastWheelLevel || drilLevel != lastDrilLevel;
+	router.resize(knowledge.width, knowledge.height);
+	lastWheelLevel = wheelLevel;
+	lastDrilLevel = drilLevel;
+
+	auto update = [&](int cell) {
+		int x = cell % knowledge.width;
+		int y = cell / knowledge.width;
+		router.setCost(x, y, routeCost(knowledge.get(x, y), wheelLevel, drilLevel));
+	};
 
-	openSet.push(Node(start, 0, calculateHeuristic(start, target)));
+	if (all) {
+		for (int cell = 0; cell < knowledge.width * knowledge.height; ++cell) {
+			update(cell);
+		}
+	}
+	else {
+		for (int cell : knowledge.changed) {
+			update(cell);
+		}
+	}
+}
 
-	while (!openSet.empty()) {
+//one sweep from the rover, not going back to the previous position to prevent oscillation
+void updateDistances(location current) {
+	int previousCell = -1;
+	if (previousPosition != current && walkable.isPassable(previousPosition.x, previousPosition.y)) {
+		previousCell = previousPosition.y * walkable.width + previousPosition.x;
+		walkable.passable[previousCell] = 0;
+	}
 
-		Node current = openSet.top();
-		openSet.pop();
+	field.compute(walkable, {{current.x, current.y}});
 
-		if (current.pos.x == target.x && current.pos.y == target.y) {
-			vector<location> path;
-			while (!(current.pos.x == start.x && current.pos.y == start.y)) {
-				path.push_back(current.pos);
-				current = nodeInfo[current.pos.x][current.pos.y];
-			}
-			path.push_back(start);
-			reverse(path.begin(), path.end());
-			return path;
-		}
+	if (previousCell >= 0) {
+		walkable.passable[previousCell] = 1;
+	}
+}
 
-		closedSet[current.pos.x][current.pos.y] = true;
+//repairs the route to target and plans its moves and digging into plan. The route is kept between turns
+//so it doesn't flip between equally good ones, returns the cells from start to target, empty if it can't be reached
+vector<location> pathFind(location start, location target, int wheelLevel) {
+	static vector<GridPoint> gridPath;
+	vector<location> path;
 
-		vector<location> neighbors = getNeighbors(current.pos, grid, id);
+	if (!router.findPath({start.x, start.y}, {target.x, target.y}, gridPath)) {
+		plan.clear();
+		return path;
+	}
 
-		for (const location& neighbor : neighbors) {
-			if (isValid(neighbor.x, neighbor.y, grid) && !closedSet[neighbor.x][neighbor.y]) {
-				int testG = current.g + 1;
+	auto isRock = [](int x, int y) { return miningTileKind(knowledge.get(x, y)) == MiningRock; };
+	planAlongPath(gridPath, wheelLevel, isRock, plan);
 
-				if (testG < nodeInfo[neighbor.x][neighbor.y].g || nodeInfo[neighbor.x][neighbor.y].g == -1) {
-					openSet.push(Node(neighbor, testG, calculateHeuristic(neighbor, target)));
-					nodeInfo[neighbor.x][neighbor.y] = Node(current.pos, testG, calculateHeuristic(neighbor, target));
-				}
-			}
-		}
+	path.reserve(gridPath.size());
+	for (auto& p : gridPath) {
+		path.emplace_back(p.x, p.y);
 	}
-
-	//empty list
-	return vector<location>();
+	return path;
 }
 
 
@@ -137,88 +153,38 @@ void printGrid(vector<vector<char>>& grid) {
 	}
 }
 
-//bedrock tracking
-void printBedrockCoordinates(vector<vector<char>>& grid) {
-	for (int i = 0; i < grid.size(); ++i) {
-		for (int j = 0; j < grid[i].size(); ++j) {
-			if (grid[i][j] == 'B') {
-				cout << "Bedrock at: (" << j << ", " << i << ")" << endl;
-				bedrockBlacklist.push_back(location(j, i));//add bedrock to blacklist
-			}
-		}
-	}
+//bedrock tracking, merges the view into the knowledge grid and prints the bedrock found this turn
+void printBedrockCoordinates(vector<vector<char>>& grid, int round) {
+	int newBedrock = knowledge.observe(grid, round);
+	cout << "New bedrock: " << newBedrock << endl;
 }
 
-//checking for resources in vision, default 5x5.
-bool hasResourceVision(location& current, vector<vector<char>>& grid, int visionWidth, int visionHeight) {
-	for (int dx = -visionWidth / 2; dx <= visionWidth / 2; ++dx) {
-		for (int dy = -visionHeight / 2; dy <= visionHeight / 2; ++dy) {
-			int x = current.x + dx;
-			int y = current.y + dy;
-
-			if (x >= 0 && x < grid.size() && y >= 0 && y < grid[0].size()) {
-				if (grid[y][x] == 'C' || grid[y][x] == 'D') {//iron and osmium
-					return true;
-				}
-			}
-		}
-	}
-
-	return false;
-}
-
-//returns location of resource in vision.
+//returns location of the resource in vision that is the fewest steps away, (-1, -1) if none can be reached.
 location findResourceVision(location& current, vector<vector<char>>& grid, int visionWidth, int visionHeight) {
+	vector<GridPoint> resources;
 	for (int dx = -visionWidth / 2; dx <= visionWidth / 2; ++dx) {
 		for (int dy = -visionHeight / 2; dy <= visionHeight / 2; ++dy) {
 			int x = current.x + dx;
 			int y = current.y + dy;
 
 			if (x >= 0 && x < grid.size() && y >= 0 && y < grid[0].size()) {
-				if (grid[y][x] == 'C' || grid[y][x] == 'D') {
-					return location(x, y);
+				if (grid[y][x] == 'C' || grid[y][x] == 'D') {//iron and osmium
+					resources.push_back({x, y});
 				}
 			}
 		}
 	}
 
-	return location(-1, -1);
-}
-
-//checks for if nextnext move will be a turn for efficient turns.
-bool isTurn(location current, location next, location nextNext) {
-	if (next.x == current.x) {
-		if (next.y == nextNext.y && next.x != nextNext.x) {
-			return true;
-		}
-	}
-	else if (next.y == current.y) {
-		if (next.x == nextNext.x && next.y != nextNext.y) {
-			return true;
-		}
+	int nearest = field.nearest(resources);
+	if (nearest < 0) {
+		return location(-1, -1);
 	}
-	return false;
+	return location(resources[nearest].x, resources[nearest].y);
 }
 
-//mining in nextnext move direction for efficient turning.
-string mineInDirection(location& current, location& nextMove, location& nextNextMove) {
-
-	//mining in nextNextMove direction
-	if (isTurn(current, nextMove, nextNextMove)) {
-		if (nextNextMove.x < nextMove.x) {
-			return " M L";
-		}
-		else if (nextNextMove.x > nextMove.x) {
-			return " M R";
-		}
-		else if (nextNextMove.y < nextMove.y) {
-			return " M U";
-		}
-		else if (nextNextMove.y > nextMove.y) {
-			return " M D";
-		}
-	}
-	return "";
+//checking for reachable resources in vision, default 5x5.
+bool hasResourceVision(location& current, vector<vector<char>>& grid, int visionWidth, int visionHeight) {
+	return findResourceVision(current, grid, visionWidth, visionHeight).x != -1;
 }
 
 //checking player in vision
@@ -384,8 +350,13 @@ int main()
 
 	};
 
+	TurnWait turnWait;
+
 	std::string serverFileName = "game/s" + std::to_string(id) + "_" + std::to_string(round) +
 		".txt";
+	if (!turnWait.wait(serverFileName)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
 	std::ifstream input(serverFileName);
 
 	//getting base location initially
@@ -445,6 +416,9 @@ int main()
 		std::string serverFileName = "game/s" + std::to_string(id) + "_" + std::to_string(round) +
 			".txt";
 
+		//sleeps until the server writes it
+		bool complete = turnWait.wait(serverFileName);
+
 		std::ifstream input(serverFileName);
 
 		if (input)
@@ -452,7 +426,9 @@ int main()
 			cout << loc_number << endl;
 
 			//sleep a little to make sure that the file was written bt the server
-			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			if (!complete) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
 
 			//it is our turn to move
 			//read the file...
@@ -522,7 +498,10 @@ int main()
 			}
 
 			//printGrid(grid);
-			printBedrockCoordinates(grid);
+			printBedrockCoordinates(grid, round);
+			updatePassable(grid);
+			updateDistances(current);
+			updateRouteCosts(move, dig);
 
 
 			input.close();
@@ -538,15 +517,22 @@ int main()
 
 			// ...
 
-			//calculating closest target and prioritizing those targets using calculateHeuristic.
-			//Manhattan distance.
-			vector<int> heuristicsTargetList;
+			//closest target by real steps from the distance field, Manhattan distance if none is reachable.
+			vector<GridPoint> targetPoints;
 			for (const auto& t : targetListings) {
-				heuristicsTargetList.push_back(calculateHeuristic(current, t));
+				targetPoints.push_back({t.x, t.y});
 			}
 
-			auto minHeuristic = min_element(heuristicsTargetList.begin(), heuristicsTargetList.end());
-			int closestTarget = distance(heuristicsTargetList.begin(), minHeuristic);
+			int closestTarget = field.nearest(targetPoints);
+			if (closestTarget < 0) {
+				vector<int> heuristicsTargetList;
+				for (const auto& t : targetListings) {
+					heuristicsTargetList.push_back(calculateHeuristic(current, t));
+				}
+
+				auto minHeuristic = min_element(heuristicsTargetList.begin(), heuristicsTargetList.end());
+				closestTarget = distance(heuristicsTargetList.begin(), minHeuristic);
+			}
 			//default is 5, i dont act change this i think cuz i dont use sight upgrades
 			int vision = 5;
 
@@ -612,7 +598,7 @@ int main()
 			
 
 			//calling pathfinding, calculated every round
-			vector<location> path = pathFind(current, target, grid, id);
+			vector<location> path = pathFind(current, target, move);
 
 			//debugging info and also to erase targets once reached. clears path and makes a new one for the next target.
 			cout << "Path Size: " << path.size() << endl;
@@ -626,7 +612,7 @@ int main()
 						if (!targetListings.empty()) {
 							targetListings.erase(targetInList);
 							path.clear();
-							vector<location> path = pathFind(current, target, grid, id);
+							vector<location> path = pathFind(current, target, move);
 						}
 					}
 				}
@@ -651,21 +637,14 @@ int main()
 			if (!path.empty() && path.size() > 1) {
 
 				location nextMove = path[1];
-				location nextNextMove(-1, -1);
-
-				if (path.size() > 2) {
-					nextNextMove = path[2];
-				}
-				else {
-					nextNextMove = nextMove;
-				}
-
 
 				string moveCommand = "";
 				string moveDirection = "";
-				string mineDirection = "";
 				string attackDirection = "";
 
+				//this turn's moves and digging from the plan
+				string plannedCommand = firstTurnCommands({current.x, current.y}, plan);
+
 				string buyHeal = "";
 				string buy = "";
 
@@ -676,52 +655,25 @@ int main()
 					buy = " B A";
 				}
 
-				if (nextMove.x < current.x) {
-					moveDirection = "L";
-					mineDirection = " M L";
-					attackDirection = " A L";
+				char direction = gridDirectionLetter({current.x, current.y}, {nextMove.x, nextMove.y});
+				attackDirection = string(" A ") + direction;
 
+				//rock in the way can't be driven into, attacking takes the action instead of digging
+				if (!plan[0].mined) {
+					moveDirection = string(1, direction);
 				}
-				else if (nextMove.x > current.x) {
-					moveDirection = "R";
-					mineDirection = " M R";
-					attackDirection = " A R";
-				}
-				else if (nextMove.y < current.y) {
-					moveDirection = "U";
-					mineDirection = " M U";
-					attackDirection = " A U";
-
-				}
-				else if (nextMove.y > current.y) {
-					moveDirection = "D";
-					mineDirection = " M D";
-					attackDirection = " A D";
-
-					
-				}
-				
-				if (grid[nextMove.y][nextMove.x] == '.') {
-					if (isTurn(current, nextMove, nextNextMove)) {
-						mineDirection = mineInDirection(current, nextMove, nextNextMove);
-					}
-				}
-				
-				
-				
-				
 
 				//debugging stuff for movement
 				cout << "Move Direction: " << moveDirection << endl;
-				cout << "Mine Direction: " << mineDirection << endl;
-				cout << "TURN NEXT: " << isTurn(current, nextMove, nextNextMove) << endl;
+				cout << "Planned: " << plannedCommand << endl;
+				cout << "Turns to target: " << plan.back().turn + 1 << endl;
 
 				if (attackPhase) {
 					moveCommand = moveDirection + attackDirection + buyHeal + buy + "\n";
 					phase = "ATTACK";
 				}
 				else {
-					moveCommand = moveDirection + mineDirection + buyHeal + buy + "\n";
+					moveCommand = plannedCommand + buyHeal + buy + "\n";
 					if (centerPhase) {
 						phase = "CENTER";
 					}
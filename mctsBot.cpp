@@ -0,0 +1,549 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cmath>
+#include <algorithm>
+#include "botLib/forwardModel.h"
+#include "botLib/turnOptions.h"
+#include "botLib/terrainKnowledge.h"
+#include "botLib/turnWait.h"
+using namespace std;
+
+//Reference bot that searches with the forward model: Monte Carlo tree search over its own
+//turns, the other rovers play a simple policy in between. Every thread grows its own tree
+//from the same root for the turn's time budget, then the root visits are added up.
+//usage: mctsBot [milliseconds per turn] [threads]
+
+static int TURN_BUDGET_MS = 200;
+static int HORIZON = 6;              //own turns simulated before the state is scored
+static double EXPLORATION = 0.7;
+
+#pragma region server file
+
+struct ServerView
+{
+	int width = 0;
+	int height = 0;
+	vector<vector<char>> grid;
+	int x = 0, y = 0;
+	int life = 0, drill = 1, gun = 1, wheel = 1, camera = 1;
+	bool antenna = 0, battery = 0;
+	int stones = 0, iron = 0, osmium = 0;
+};
+
+bool readServerFile(const string &path, ServerView &view)
+{
+	ifstream f(path);
+	if (!f) { return false; }
+
+	f >> view.width >> view.height;
+	if (!f || view.width <= 0 || view.height <= 0) { return false; }
+
+	view.grid.assign(view.height, vector<char>(view.width, '?'));
+	for (int y = 0; y < view.height; y++)
+	{
+		for (int x = 0; x < view.width; x++)
+		{
+			f >> view.grid[y][x];
+		}
+	}
+
+	int antenna = 0, battery = 0;
+	f >> view.x >> view.y;
+	f >> view.life >> view.drill >> view.gun >> view.wheel >> view.camera >> antenna >> battery;
+	f >> view.stones >> view.iron >> view.osmium;
+	view.antenna = antenna;
+	view.battery = battery;
+
+	return (bool)f;
+}
+
+#pragma endregion
+
+#pragma region turn options
+
+struct Candidate
+{
+	TurnCode turn = 0;
+	float prior = 0; //how good it looks without searching, the rollouts lean on it
+};
+
+bool acidIsNear(const SimState &s)
+{
+	return s.currentBorderAdvance > 0 || s.borderCulldown < 30;
+}
+
+//the legal turns without buys, autoBuy adds those
+void candidateTurns(const SimState &s, int rover, vector<Candidate> &out)
+{
+	static thread_local vector<TurnCode> turns;
+	legalTurns(s, rover, turns, false);
+	out.clear();
+
+	auto &r = s.rovers[rover];
+
+	for (TurnCode turn : turns)
+	{
+		int ex, ey;
+		turnEndCell(turn, r.x, r.y, ex, ey);
+
+		float prior = 0.1f * (turnMoveCount(turn) > 0);
+		if (s.get(ex, ey) == 'F') { prior -= 5; }
+		if (acidIsNear(s))
+		{
+			prior -= 0.05f * (abs(ex - s.width / 2) + abs(ey - s.height / 2));
+		}
+
+		switch (turnAction(turn))
+		{
+		case TurnMine:
+		for (int d = 0; d < 4; d++)
+		{
+			if (!(turnMineMask(turn) & (1 << d))) { continue; }
+			char t = s.get(ex + turnDirectionX[d], ey + turnDirectionY[d]);
+			prior += t == 'D' ? 3.f : t == 'C' ? 2.f : 0.3f;
+		}
+		break;
+		case TurnAttack: prior += 3.f + r.gunLevel; break;
+		case TurnPlace: prior -= 0.5f; break;
+		case TurnScan: prior -= 1.f; break; //shows nothing here, the search sees everything
+		default: break;
+		}
+
+		out.push_back({turn, prior});
+	}
+}
+
+//buys on top of a turn, in order of how much they help, as long as they can be paid
+string autoBuy(SimState &s, int rover)
+{
+	string buys;
+	auto &r = s.rovers[rover];
+
+	auto tryBuy = [&](char item)
+	{
+		if (s.buy(rover, item))
+		{
+			buys += " B ";
+			buys += item;
+			return true;
+		}
+		return false;
+	};
+
+	tryBuy('B');
+	if (r.life <= SIM_MAX_ROVER_LIFE - 5) { tryBuy('H'); }
+	tryBuy('M');
+	tryBuy('D');
+	tryBuy('A');
+
+	return buys;
+}
+
+//the turn for the waiting rover, its buys and the end of the turn. Returns the buys
+string playTurn(SimState &s, TurnCode turn)
+{
+	int rover = s.waitingFor;
+	applyTurn(s, rover, turn);
+	string buys = autoBuy(s, rover);
+	s.endTurn();
+	return buys;
+}
+
+int rolloutChoice(const vector<Candidate> &candidates, mt19937 &rng)
+{
+	if (rng() % 2)
+	{
+		int best = 0;
+		for (int i = 1; i < (int)candidates.size(); i++)
+		{
+			if (candidates[i].prior > candidates[best].prior) { best = i; }
+		}
+		return best;
+	}
+	return rng() % candidates.size();
+}
+
+#pragma endregion
+
+#pragma region search
+
+double score(const SimState &s, int id)
+{
+	int index = s.indexOf(id);
+	if (index < 0) { return -100; }
+
+	auto &r = s.rovers[index];
+	double result = r.life * 1.0 + r.iron * 1.5 + r.osmium * 4.0 + r.stones * 0.05
+		+ (r.wheelLevel + r.drilLevel + r.gunLevel - 3) * 6.0 + r.hasBatery * 6.0;
+
+	for (auto &other : s.rovers)
+	{
+		if (other.id != id) { result -= other.life * 0.5; }
+	}
+	result -= (s.rovers.size() - 1) * 10.0;
+
+	if (s.get(r.x, r.y) == 'F') { result -= 5; }
+	if (acidIsNear(s))
+	{
+		result -= 0.2 * (abs(r.x - s.width / 2) + abs(r.y - s.height / 2));
+	}
+
+	return result;
+}
+
+struct Node
+{
+	vector<Candidate> actions;
+	vector<int> children; //-1 until visited
+	vector<int> visits;
+	vector<double> values;
+	int totalVisits = 0;
+	bool expanded = 0;
+};
+
+struct SearchTree
+{
+	vector<Node> nodes;
+	mt19937 rng;
+
+	void search(const SimState &root, int id, double rootScore, chrono::steady_clock::time_point deadline)
+	{
+		nodes.clear();
+		nodes.emplace_back();
+
+		vector<pair<int, int>> path;
+		vector<Candidate> candidates;
+
+		for (int iteration = 0; ; iteration++)
+		{
+			if ((iteration & 15) == 0 && chrono::steady_clock::now() >= deadline) { break; }
+
+			SimState s = root;
+			path.clear();
+			int node = 0;
+			int ownTurns = 0;
+			bool inTree = true;
+
+			while (ownTurns < HORIZON && s.indexOf(id) >= 0)
+			{
+				int rover = s.waitingFor;
+
+				bool own = s.rovers[rover].id == id;
+
+				//the other rovers, and past the tree everyone, play the rollout policy
+				if (!own || !inTree)
+				{
+					candidateTurns(s, rover, candidates);
+					playTurn(s, candidates[rolloutChoice(candidates, rng)].turn);
+					ownTurns += own;
+					continue;
+				}
+
+				if (!nodes[node].expanded)
+				{
+					Node &n = nodes[node];
+					candidateTurns(s, rover, n.actions);
+					n.children.assign(n.actions.size(), -1);
+					n.visits.assign(n.actions.size(), 0);
+					n.values.assign(n.actions.size(), 0);
+					n.expanded = 1;
+				}
+
+				int action = select(nodes[node]);
+				playTurn(s, nodes[node].actions[action].turn);
+				path.push_back({node, action});
+				ownTurns++;
+
+				if (nodes[node].visits[action] == 0)
+				{
+					inTree = false;
+				}
+				else
+				{
+					if (nodes[node].children[action] < 0)
+					{
+						nodes[node].children[action] = nodes.size();
+						nodes.emplace_back();
+					}
+					node = nodes[node].children[action];
+				}
+			}
+
+			double value = s.indexOf(id) < 0 ? 0 : 1.0 / (1.0 + exp(-(score(s, id) - rootScore) / 8.0));
+
+			for (auto &p : path)
+			{
+				Node &n = nodes[p.first];
+				n.visits[p.second]++;
+				n.values[p.second] += value;
+				n.totalVisits++;
+			}
+		}
+	}
+
+	//untried actions first, the best looking of them, then UCT
+	int select(const Node &n)
+	{
+		int best = -1;
+		double bestValue = -1e30;
+
+		for (int i = 0; i < (int)n.actions.size(); i++)
+		{
+			double v;
+			if (n.visits[i] == 0)
+			{
+				v = 1e6 + n.actions[i].prior + (rng() % 1000) * 1e-6;
+			}
+			else
+			{
+				v = n.values[i] / n.visits[i]
+					+ EXPLORATION * sqrt(log((double)n.totalVisits) / n.visits[i]);
+			}
+
+			if (v > bestValue)
+			{
+				bestValue = v;
+				best = i;
+			}
+		}
+		return best;
+	}
+};
+
+//Workers that wait for a job, run it with their index and report back, kept for the whole game
+struct SearchPool
+{
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable done;
+	function<void(int)> job;
+	int generation = 0;
+	int finished = 0;
+	bool quit = 0;
+
+	void start(int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			workers.emplace_back([this, i]()
+			{
+				int seen = 0;
+				while (true)
+				{
+					{
+						unique_lock<mutex> l(lock);
+						wake.wait(l, [&]() { return quit || generation != seen; });
+						if (quit) { return; }
+						seen = generation;
+					}
+
+					job(i);
+
+					{
+						lock_guard<mutex> l(lock);
+						finished++;
+					}
+					done.notify_one();
+				}
+			});
+		}
+	}
+
+	//blocks until every worker ran it
+	void run(function<void(int)> newJob)
+	{
+		{
+			lock_guard<mutex> l(lock);
+			job = std::move(newJob);
+			finished = 0;
+			generation++;
+		}
+		wake.notify_all();
+
+		unique_lock<mutex> l(lock);
+		done.wait(l, [&]() { return finished == (int)workers.size(); });
+	}
+
+	~SearchPool()
+	{
+		{
+			lock_guard<mutex> l(lock);
+			quit = 1;
+		}
+		wake.notify_all();
+		for (auto &w : workers) { w.join(); }
+	}
+};
+
+#pragma endregion
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) { TURN_BUDGET_MS = max(atoi(argv[1]), 1); }
+	int threads = argc > 2 ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+	threads = max(threads, 1);
+
+	int id = 0;
+	std::cout << "enter id: ";
+	std::cin >> id;
+
+	int round = 0;
+
+	TurnWait turnWait;
+	TerrainKnowledge knowledge;
+	SearchPool pool;
+	pool.start(threads);
+	vector<SearchTree> trees(threads);
+	for (int i = 0; i < threads; i++) { trees[i].rng.seed(random_device()() + i); }
+
+	int spawnX = -1;
+	int spawnY = -1;
+
+	while (true)
+	{
+		std::string serverFileName = "game/s" + std::to_string(id) + "_" + std::to_string(round) +
+			".txt";
+
+		//sleeps until the server writes it
+		bool complete = turnWait.wait(serverFileName);
+		auto turnStart = chrono::steady_clock::now();
+
+		//sleep a little to make sure that the file was written bt the server
+		if (!complete) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }
+
+		ServerView view;
+		if (!readServerFile(serverFileName, view)) { continue; }
+
+		if (spawnX < 0)
+		{
+			spawnX = view.x;
+			spawnY = view.y;
+		}
+
+		knowledge.observe(view.grid, round);
+
+		//the root: what was seen, fog is guessed to be stone, other rovers have starting stats
+		SimState root;
+		root.create(view.width, view.height, 'X');
+		for (int y = 0; y < view.height; y++)
+		{
+			for (int x = 0; x < view.width; x++)
+			{
+				char t = knowledge.get(x, y);
+				if (t != TerrainKnowledge::UNKNOWN) { root.set(x, y, t); }
+			}
+		}
+
+		for (int y = 0; y < view.height; y++)
+		{
+			for (int x = 0; x < view.width; x++)
+			{
+				char c = view.grid[y][x];
+				if (!TerrainKnowledge::isPlayer(c) || c - '0' == id) { continue; }
+
+				SimRover other;
+				other.id = c - '0';
+				other.x = other.spawnX = x;
+				other.y = other.spawnY = y;
+				root.rovers.push_back(other);
+			}
+		}
+
+		SimRover self;
+		self.id = id;
+		self.x = view.x;
+		self.y = view.y;
+		self.life = view.life;
+		self.drilLevel = view.drill;
+		self.gunLevel = view.gun;
+		self.wheelLevel = view.wheel;
+		self.cameraLevel = view.camera;
+		self.hasAntena = view.antenna;
+		self.hasBatery = view.battery;
+		self.stones = view.stones;
+		self.iron = view.iron;
+		self.osmium = view.osmium;
+		self.spawnX = spawnX;
+		self.spawnY = spawnY;
+		self.currentRound = round;
+		root.rovers.push_back(self);
+
+		//the server plays the rovers in id order
+		sort(root.rovers.begin(), root.rovers.end(),
+			[](const SimRover &a, const SimRover &b) { return a.id < b.id; });
+		root.waitingFor = root.indexOf(id);
+
+		//every rover played as many turns as we did, the acid follows from that
+		int cycles = round;
+		if (cycles < SIM_ACID_START_TIME)
+		{
+			root.borderCulldown = SIM_ACID_START_TIME - cycles;
+			root.currentBorderAdvance = 0;
+		}
+		else
+		{
+			int k = cycles - SIM_ACID_START_TIME;
+			root.borderCulldown = 2 - k % 2;
+			root.currentBorderAdvance = min(k / 2 + 1, max(min(view.width, view.height) / 2 - 1, 0));
+		}
+
+		vector<Candidate> rootActions;
+		candidateTurns(root, root.waitingFor, rootActions);
+
+		double rootScore = score(root, id);
+		auto deadline = turnStart + chrono::milliseconds(TURN_BUDGET_MS);
+
+		pool.run([&](int worker)
+		{
+			trees[worker].search(root, id, rootScore, deadline);
+		});
+
+		//the root actions are the same in every tree, add the visits up
+		vector<long long> visits(rootActions.size(), 0);
+		long long total = 0;
+		for (auto &t : trees)
+		{
+			if (t.nodes.empty() || !t.nodes[0].expanded) { continue; }
+			for (size_t i = 0; i < rootActions.size() && i < t.nodes[0].visits.size(); i++)
+			{
+				visits[i] += t.nodes[0].visits[i];
+				total += t.nodes[0].visits[i];
+			}
+		}
+
+		int best = 0;
+		for (int i = 1; i < (int)rootActions.size(); i++)
+		{
+			if (visits[i] > visits[best]) { best = i; }
+		}
+
+		SimState after = root;
+		TurnCode turn = rootActions[best].turn;
+		string command = turnCommands(turn) + playTurn(after, turn);
+
+		size_t first = command.find_first_not_of(' ');
+		command = first == string::npos ? "" : command.substr(first);
+
+		std::string ourFileName = "game/c" + std::to_string(id) + "_" + std::to_string(round) +
+			".txt";
+		std::ofstream response(ourFileName);
+		response << command << "\n";
+		response.close();
+
+		cout << "ROUND: " << round << " COMMAND: " << command << " ROLLOUTS: " << total
+			<< " THREADS: " << threads << endl;
+
+		//increment the round
+		round++;
+	}
+	return 0;
+}
@@ -0,0 +1,318 @@
+#include <frameCapture.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+bool FrameCapture::start(const std::string &path, CaptureFormat format, int framesPerTurn, int fps)
+{
+	stop();
+
+	std::error_code error = {};
+	if (format == CapturePNG)
+	{
+		std::filesystem::create_directories(path, error);
+		if (error) { return false; }
+	}
+	else
+	{
+		auto folder = std::filesystem::path(path).parent_path();
+		if (!folder.empty()) { std::filesystem::create_directories(folder, error); }
+
+		video = fopen(path.c_str(), "wb");
+		if (!video) { return false; }
+	}
+
+	this->path = path;
+	this->format = format;
+	this->framesPerTurn = framesPerTurn;
+	this->fps = std::max(fps, 1);
+	videoSize = {};
+	imageIndex = 0;
+	framesLeft = framesPerTurn;
+	capturedFrames = 0;
+	droppedFrames = 0;
+	recording = 1;
+
+	startEncoder();
+	return true;
+}
+
+void FrameCapture::stop()
+{
+	collect(true);
+	stopEncoder();
+
+	recording = 0;
+	framesLeft = 0;
+
+	if (video)
+	{
+		fclose(video);
+		video = nullptr;
+	}
+}
+
+void FrameCapture::requestThumbnail(const std::string &path)
+{
+	std::error_code error = {};
+	auto folder = std::filesystem::path(path).parent_path();
+	if (!folder.empty()) { std::filesystem::create_directories(folder, error); }
+
+	pendingThumbnail = path;
+	startEncoder();
+}
+
+void FrameCapture::cleanup()
+{
+	stop();
+
+	for (auto &r : readBacks)
+	{
+		if (r.pbo) { glDeleteBuffers(1, &r.pbo); }
+		r = {};
+	}
+	nextReadBack = 0;
+}
+
+//moves the finished read backs to the encoder, wait also takes the ones still in flight
+void FrameCapture::collect(bool wait)
+{
+	for (int i = 0; i < PBO_COUNT; i++)
+	{
+		//oldest first so the frames stay in order
+		auto &r = readBacks[(nextReadBack + i) % PBO_COUNT];
+		if (!r.fence) { continue; }
+
+		GLenum status = glClientWaitSync(r.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+			wait ? 1'000'000'000ull : 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			if (!wait) { break; }
+		}
+
+		glDeleteSync(r.fence);
+		r.fence = 0;
+
+		Frame frame;
+		frame.size = r.size;
+		frame.video = r.video;
+		frame.thumbnailPath = std::move(r.thumbnailPath);
+		r.thumbnailPath.clear();
+
+		size_t bytes = (size_t)r.size.x * r.size.y * 4;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (queue.size() >= MAX_QUEUED_FRAMES && frame.thumbnailPath.empty())
+			{
+				droppedFrames++;
+				continue;
+			}
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+		void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+		if (data)
+		{
+			frame.rgba.resize(bytes);
+			memcpy(frame.rgba.data(), data, bytes);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		if (frame.rgba.empty()) { continue; }
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(frame));
+		}
+		wake.notify_one();
+	}
+}
+
+void FrameCapture::update(gl2d::FrameBuffer &frameBuffer, bool newTurn)
+{
+	if (newTurn && recording) { framesLeft = framesPerTurn; }
+
+	collect(false);
+
+	bool videoFrame = recording && framesLeft > 0;
+	if (!videoFrame && pendingThumbnail.empty()) { return; }
+
+	auto &r = readBacks[nextReadBack];
+
+	//still in flight, try again next frame rather than wait for it
+	if (r.fence) { return; }
+
+	glm::ivec2 size = frameBuffer.texture.GetSize();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	if (size.x <= 0 || size.y <= 0) { return; }
+
+	size_t bytes = (size_t)size.x * size.y * 4;
+
+	if (!r.pbo) { glGenBuffers(1, &r.pbo); }
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+	if (r.size != size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		r.size = size;
+	}
+
+	GLint previousFbo = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFbo);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer.fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	r.video = videoFrame;
+	r.thumbnailPath = std::move(pendingThumbnail);
+	pendingThumbnail.clear();
+
+	nextReadBack = (nextReadBack + 1) % PBO_COUNT;
+
+	if (videoFrame)
+	{
+		framesLeft--;
+		capturedFrames++;
+	}
+}
+
+#pragma region encoder
+
+void FrameCapture::startEncoder()
+{
+	if (encoder.joinable()) { return; }
+
+	encoderRunning = 1;
+	encoder = std::thread([this]() { encode(); });
+}
+
+void FrameCapture::stopEncoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		encoderRunning = 0;
+	}
+	wake.notify_all();
+
+	if (encoder.joinable()) { encoder.join(); }
+}
+
+//finishes the queue before exiting
+void FrameCapture::encode()
+{
+	while (true)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return !encoderRunning || !queue.empty(); });
+			if (queue.empty()) { return; }
+			frame = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		writeFrame(frame);
+	}
+}
+
+//the alpha of the frame buffer is dropped, rgb is scratch memory
+static void writePNG(const char *path, const std::vector<unsigned char> &rgba, glm::ivec2 size,
+	std::vector<unsigned char> &rgb)
+{
+	size_t pixels = (size_t)size.x * size.y;
+	rgb.resize(pixels * 3);
+	for (size_t i = 0; i < pixels; i++)
+	{
+		rgb[i * 3 + 0] = rgba[i * 4 + 0];
+		rgb[i * 3 + 1] = rgba[i * 4 + 1];
+		rgb[i * 3 + 2] = rgba[i * 4 + 2];
+	}
+
+	//opengl gives the bottom row first, start at the last row and walk back up
+	int stride = size.x * 3;
+	stbi_write_png(path, size.x, size.y, 3, rgb.data() + (size_t)(size.y - 1) * stride, -stride);
+}
+
+void FrameCapture::writeFrame(Frame &frame)
+{
+	if (!frame.thumbnailPath.empty())
+	{
+		writePNG(frame.thumbnailPath.c_str(), frame.rgba, frame.size, rgb);
+	}
+
+	if (!frame.video) { return; }
+
+	if (format == CapturePNG)
+	{
+		char name[32] = {};
+		snprintf(name, sizeof(name), "/frame_%05d.png", imageIndex++);
+		writePNG((path + name).c_str(), frame.rgba, frame.size, rgb);
+		return;
+	}
+
+	if (!video) { return; }
+
+	//4:2:0 wants even sizes
+	if (videoSize.x == 0)
+	{
+		videoSize = (frame.size / 2) * 2;
+		if (videoSize.x == 0 || videoSize.y == 0) { videoSize = {}; return; }
+
+		fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", videoSize.x, videoSize.y, fps);
+	}
+
+	glm::ivec2 size = videoSize;
+	yuv.assign((size_t)size.x * size.y * 3 / 2, 0);
+	unsigned char *yPlane = yuv.data();
+	unsigned char *uPlane = yPlane + (size_t)size.x * size.y;
+	unsigned char *vPlane = uPlane + (size_t)size.x * size.y / 4;
+
+	//frames of another size are cropped or padded with black, top left aligned
+	auto pixel = [&](int x, int y) -> glm::vec3
+	{
+		if (x >= frame.size.x || y >= frame.size.y) { return {}; }
+		const unsigned char *p = &frame.rgba[((size_t)(frame.size.y - 1 - y) * frame.size.x + x) * 4];
+		return {p[0], p[1], p[2]};
+	};
+
+	//bt.601 full range, what C420jpeg means
+	for (int y = 0; y < size.y; y += 2)
+	{
+		for (int x = 0; x < size.x; x += 2)
+		{
+			glm::vec3 sum = {};
+			for (int j = 0; j < 2; j++)
+			{
+				for (int i = 0; i < 2; i++)
+				{
+					glm::vec3 c = pixel(x + i, y + j);
+					sum += c;
+					float luma = 0.299f * c.r + 0.587f * c.g + 0.114f * c.b;
+					yPlane[(size_t)(y + j) * size.x + x + i] = (unsigned char)glm::clamp(luma + 0.5f, 0.f, 255.f);
+				}
+			}
+
+			glm::vec3 c = sum / 4.f;
+			float u = 128.f - 0.168736f * c.r - 0.331264f * c.g + 0.5f * c.b;
+			float v = 128.f + 0.5f * c.r - 0.418688f * c.g - 0.081312f * c.b;
+
+			size_t chroma = (size_t)(y / 2) * (size.x / 2) + x / 2;
+			uPlane[chroma] = (unsigned char)glm::clamp(u + 0.5f, 0.f, 255.f);
+			vPlane[chroma] = (unsigned char)glm::clamp(v + 0.5f, 0.f, 255.f);
+		}
+	}
+
+	fputs("FRAME\n", video);
+	fwrite(yuv.data(), yuv.size(), 1, video);
+}
+
+#pragma endregion
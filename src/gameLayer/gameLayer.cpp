@@ -14,7 +14,13 @@
 #include <fstream>
 #include <filesystem>
 #include <mapGenerator.h>
+#include <mapArchive.h>
+#include <tilemapLayer.h>
+#include <roverSpriteCache.h>
+#include <frameCapture.h>
 #include <thread>
+#include <random>
+#include <ctime>
 #ifdef _WIN32 
 #include <raudio.h>
 #endif
@@ -31,6 +37,13 @@ gl2d::TextureAtlasPadding spritesAtlas;
 gl2d::FrameBuffer fbo;
 gl2d::Font font;
 
+TilemapLayer mapLayer;
+RoverSpriteCache roverCache;
+FrameCapture frameCapture;
+
+WorldArchive worldArchive;
+WorldPregenerator worldPregenerator;
+
 #ifdef _WIN32 
 Sound killSound;
 Sound susSound;
@@ -62,9 +75,36 @@ struct GameplayState
 	bool closeGameWhenWinning = 0;
 	bool pause = 0;
 
+	int turnsResolved = 0;
+
+	//gameStateHash after the last resolved turn, also written to game/hashes.txt every turn
+	unsigned long long turnHash = 0;
+	int hashedTurns = 0;
 
 }gameplayState;
 
+//zobrist hash of the game state: the map's running hash, the rovers, whose turn it is and the acid.
+//Two runs (or two builds) that play the same turns get the same hashes
+unsigned long long gameStateHash()
+{
+	unsigned long long h = gameplayState.map.hash;
+
+	for (auto &p : gameplayState.players)
+	{
+		h ^= p.hash();
+	}
+
+	if (gameplayState.players.size())
+	{
+		h ^= zobristKey(ZobristGame, 0,
+			gameplayState.players[gameplayState.waitingForPlayerIndex].id);
+	}
+	h ^= zobristKey(ZobristGame, 1, gameplayState.borderCulldown);
+	h ^= zobristKey(ZobristGame, 2, gameplayState.currentBorderAdvance);
+
+	return h;
+}
+
 struct WinState
 {
 	std::string winMessage;
@@ -435,21 +475,21 @@ void gameStep(float deltaTime)
 								&& minePos.y < gameplayState.map.size.y
 								)
 							{
-								auto &b = gameplayState.map.unsafeGet(minePos.x, minePos.y);
+								auto b = gameplayState.map.unsafeGet(minePos.x, minePos.y);
 
 								if (b == Tiles::Stone || b == Tiles::Cobble_stone)
 								{
-									b = Tiles::Air;
+									gameplayState.map.set(minePos.x, minePos.y, Tiles::Air);
 									gameplayState.players[gameplayState.waitingForPlayerIndex].stones++;
 								}
 								else if (b == Tiles::Iron)
 								{
-									b = Tiles::Air;
+									gameplayState.map.set(minePos.x, minePos.y, Tiles::Air);
 									gameplayState.players[gameplayState.waitingForPlayerIndex].iron++;
 								}
 								else if (b == Tiles::Osmium)
 								{
-									b = Tiles::Air;
+									gameplayState.map.set(minePos.x, minePos.y, Tiles::Air);
 									gameplayState.players[gameplayState.waitingForPlayerIndex].osmium++;
 								}
 							}
@@ -505,12 +545,12 @@ void gameStep(float deltaTime)
 
 								if (!found)
 								{
-									auto &b = gameplayState.map.unsafeGet(placePos.x, placePos.y);
+									auto b = gameplayState.map.unsafeGet(placePos.x, placePos.y);
 									if (b == Tiles::Air
 										&& gameplayState.players[gameplayState.waitingForPlayerIndex].stones > 0
 										)
 									{
-										b = Tiles::Cobble_stone;
+										gameplayState.map.set(placePos.x, placePos.y, Tiles::Cobble_stone);
 										gameplayState.players[gameplayState.waitingForPlayerIndex].stones--;
 									}
 								}
@@ -678,6 +718,7 @@ void gameStep(float deltaTime)
 
 				//advance this players turn since we got the input
 				gameplayState.players[gameplayState.waitingForPlayerIndex].currentRound++;
+				gameplayState.turnsResolved++;
 
 				//next player please
 				gameplayState.waitingForPlayerIndex++;
@@ -704,14 +745,14 @@ void gameStep(float deltaTime)
 						{
 							for (int i = 0; i < gameplayState.map.size.x; i++)
 							{
-								gameplayState.map.unsafeGet(i, gameplayState.currentBorderAdvance) = Tiles::Acid;
-								gameplayState.map.unsafeGet(i, gameplayState.map.size.y-1 - gameplayState.currentBorderAdvance) = Tiles::Acid;
+								gameplayState.map.set(i, gameplayState.currentBorderAdvance, Tiles::Acid);
+								gameplayState.map.set(i, gameplayState.map.size.y-1 - gameplayState.currentBorderAdvance, Tiles::Acid);
 							}
 
 							for (int i = 0; i < gameplayState.map.size.y; i++)
 							{
-								gameplayState.map.unsafeGet(gameplayState.currentBorderAdvance, i) = Tiles::Acid;
-								gameplayState.map.unsafeGet(gameplayState.map.size.y - 1 - gameplayState.currentBorderAdvance, i) = Tiles::Acid;
+								gameplayState.map.set(gameplayState.currentBorderAdvance, i, Tiles::Acid);
+								gameplayState.map.set(gameplayState.map.size.y - 1 - gameplayState.currentBorderAdvance, i, Tiles::Acid);
 							}
 
 							gameplayState.currentBorderAdvance++;
@@ -794,6 +835,16 @@ void gameStep(float deltaTime)
 				winState.winMessage += "\n";
 			}
 
+			//once per resolved turn, after the deaths so it is the state the next turn starts from
+			if (gameplayState.hashedTurns != gameplayState.turnsResolved)
+			{
+				gameplayState.hashedTurns = gameplayState.turnsResolved;
+				gameplayState.turnHash = gameStateHash();
+
+				std::ofstream hashes("game/hashes.txt", std::ios::app);
+				hashes << gameplayState.turnsResolved << " " << std::hex << gameplayState.turnHash << "\n";
+			}
+
 
 		}
 
@@ -826,9 +877,12 @@ bool initGame()
 	fbo.create(500, 500);
 
 	renderer.create(fbo.fbo);
+
+	mapLayer.create();
 	
 	roverTexture.loadFromFileWithPixelPadding(RESOURCES_PATH "rover.png", 128, true);
 	roverAtlas = gl2d::TextureAtlasPadding(5, 5, roverTexture.GetSize().x, roverTexture.GetSize().y);
+	roverCache.create(roverTexture, roverAtlas);
 
 	spritesTexture.loadFromFileWithPixelPadding(RESOURCES_PATH "sprites.png", 128, true);
 	spritesAtlas = gl2d::TextureAtlasPadding(10, 1, spritesTexture.GetSize().x, spritesTexture.GetSize().y);
@@ -837,6 +891,9 @@ bool initGame()
 	std::filesystem::remove_all("game", error);
 	std::filesystem::create_directory("game");
 
+	worldArchive.open(RESOURCES_PATH "worlds.archive");
+	worldPregenerator.start(&worldArchive);
+
 	return true;
 }
 
@@ -1033,6 +1090,55 @@ float cameraZoom = 0.145;
 //vector pos not id
 bool simulateFog = true;
 
+CullingStats mapCulling;
+CullingStats roverCulling;
+
+//the gameplay fbo is only drawn again when what it shows changed
+bool renderOnChange = 1;
+unsigned long long lastSceneSignature = 0;
+int skippedRedraws = 0;
+
+int captureFormat = CaptureY4M;
+int captureFramesPerTurn = 2;
+int lastCapturedTurn = -1;
+
+//everything the gameplay view depends on apart from the tiles, hashed.
+//Tile writes go through Map::set and are seen in the dirty cells instead
+unsigned long long sceneSignature(glm::ivec2 fboSize)
+{
+	unsigned long long h = 14695981039346656037ull;
+	auto add = [&](const void *data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			h = (h ^ ((const unsigned char *)data)[i]) * 1099511628211ull;
+		}
+	};
+
+	add(&fboSize, sizeof(fboSize));
+	add(&renderer.currentCamera.position, sizeof(renderer.currentCamera.position));
+	add(&renderer.currentCamera.zoom, sizeof(renderer.currentCamera.zoom));
+	add(&simulateFog, sizeof(simulateFog));
+	add(&currentFollow, sizeof(currentFollow));
+	add(&gameplayState.map.size, sizeof(gameplayState.map.size));
+
+	for (auto &p : gameplayState.players)
+	{
+		add(&p.position, sizeof(p.position));
+		add(&p.color, sizeof(p.color));
+		add(&p.id, sizeof(p.id));
+		add(&p.life, sizeof(p.life));
+		add(&p.hasAntena, sizeof(p.hasAntena));
+		add(&p.hasBatery, sizeof(p.hasBatery));
+		add(&p.wheelLevel, sizeof(p.wheelLevel));
+		add(&p.cameraLevel, sizeof(p.cameraLevel));
+		add(&p.gunLevel, sizeof(p.gunLevel));
+		add(&p.drilLevel, sizeof(p.drilLevel));
+	}
+
+	return h;
+}
+
 ImVec4 colors[] = {
 		ImVec4{0,0,1,1},
 		ImVec4{1,1,0,1},
@@ -1061,6 +1167,7 @@ void sideWindow()
 	ImGui::Text(state.c_str());
 	if (gameplayState.firstTimeAcid)
 		ImGui::Text("ACID: %d", gameplayState.borderCulldown);
+	ImGui::Text("Turn %d state hash: %016llx", gameplayState.hashedTurns, gameplayState.turnHash);
 
 	ImGui::Separator();
 
@@ -1068,6 +1175,54 @@ void sideWindow()
 
 	ImGui::Checkbox("simulate fog", &simulateFog);
 
+	ImGui::Text("Tiles drawn: %d culled: %d", mapCulling.submitted, mapCulling.culled);
+	ImGui::Text("Rovers drawn: %d culled: %d", roverCulling.submitted, roverCulling.culled);
+	ImGui::Text("Rover sprites composed: %d", roverCache.composedCount);
+
+	ImGui::Checkbox("Redraw only on changes", &renderOnChange);
+	ImGui::SameLine();
+	ImGui::Text("skipped: %d", skippedRedraws);
+	bool idleThrottling = platform::isIdleThrottling();
+	if (ImGui::Checkbox("Slow down when idle", &idleThrottling))
+	{
+		platform::setIdleThrottling(idleThrottling);
+	}
+
+	ImGui::Separator();
+
+	//recordings go next to the game folder
+	if (!frameCapture.isRecording())
+	{
+		ImGui::Combo("Record as", &captureFormat, "y4m video\0png images\0");
+		ImGui::InputInt("Frames per turn", &captureFramesPerTurn);
+		captureFramesPerTurn = std::max(captureFramesPerTurn, 1);
+
+		if (ImGui::Button("Start recording"))
+		{
+			std::string name = "recordings/match_" + std::to_string(std::time(nullptr));
+			if (captureFormat == CaptureY4M) { name += ".y4m"; }
+
+			if (!frameCapture.start(name, (CaptureFormat)captureFormat, captureFramesPerTurn))
+			{
+				std::cout << "couldn't create " << name << "\n";
+			}
+		}
+	}
+	else
+	{
+		ImGui::Text("Recording: %d frames, %d dropped", frameCapture.capturedFrames, frameCapture.droppedFrames);
+		if (ImGui::Button("Stop recording"))
+		{
+			frameCapture.stop();
+		}
+	}
+
+	ImGui::SameLine();
+	if (ImGui::Button("Save thumbnail"))
+	{
+		frameCapture.requestThumbnail("recordings/thumbnail_" + std::to_string(std::time(nullptr)) + ".png");
+	}
+
 	ImGui::Checkbox("Evict players after 5 secconds", &gameplayState.evictUnresponsivePlayers);
 
 	ImGui::Checkbox("Close Game When Someone Won", &gameplayState.closeGameWhenWinning);
@@ -1192,6 +1347,16 @@ void mainMenuScreen()
 
 	static bool smallMap = 0;
 
+	static int seedsToPregenerate = 10;
+
+	//the seed used when the seed is 0, picked ahead so its world can be generated in the background
+	static int nextRandomSeed = 0;
+	if (!nextRandomSeed)
+	{
+		nextRandomSeed = std::random_device{}() & 0x7FFFFFFF;
+		if (!nextRandomSeed) { nextRandomSeed = 1; }
+	}
+
 	ImGui::SliderInt("Nr of players", &nrOfPlayers, 1, 5);
 
 	ImGui::InputInt("Seed (0 for random): ", &seed);
@@ -1199,6 +1364,26 @@ void mainMenuScreen()
 
 	ImGui::InputInt("Acid start time", &acidStartTime);
 
+	auto worldKey = [&](int s)
+	{
+		WorldKey key;
+		key.seed = s;
+		if (smallMap)
+		{
+			key.mazeSize = {30,30};
+			key.fewerResources = false;
+		}
+		else
+		{
+			key.mazeSize = {45,45};
+			key.fewerResources = true;
+		}
+		return key;
+	};
+
+	WorldKey key = worldKey(seed ? seed : nextRandomSeed);
+	worldPregenerator.request(key);
+
 	//todo sa afisez ca nu se poate
 	if (ImGui::Button("Start Game"))
 	{
@@ -1209,33 +1394,22 @@ void mainMenuScreen()
 		winState = {};
 		gameplayState = {};
 
-		int s = seed;
-		if (!s)s = time(0);
-		if (smallMap)
-		{
-			gameplayState.map = generate_world({30,30}, s, false);
-		}
-		else
+		PregeneratedWorld world;
+		if (!worldArchive.find(key, world))
 		{
-			gameplayState.map = generate_world({45,45}, s, true);
+			world = pregenerateWorld(key, 0);
+			worldArchive.add(key, world);
 		}
+		gameplayState.map = std::move(world.map);
+		gameplayState.map.rehash(); //the generator and the archive write the tiles directly
+
+		if (!seed) { nextRandomSeed = 0; }
 
 		std::ofstream seedFile(RESOURCES_PATH "game/seed.txt");
-		seedFile << s;
+		seedFile << key.seed;
 		seedFile.close();
 
-		std::vector<glm::vec2> spawnPoints;
-
-		for (int j = 0; j < gameplayState.map.size.y; j++)
-		{
-			for (int i = 0; i < gameplayState.map.size.x; i++)
-			{
-				if (gameplayState.map.unsafeGet(i, j) == Tiles::Base)
-				{
-					spawnPoints.push_back({i,j});
-				}
-			}
-		}
+		std::vector<glm::ivec2> spawnPoints = std::move(world.spawnPoints);
 
 		std::shuffle(spawnPoints.begin(), spawnPoints.end(), std::default_random_engine(time(0)));
 
@@ -1247,6 +1421,23 @@ void mainMenuScreen()
 
 	}
 
+	ImGui::Separator();
+
+	//tournaments over a fixed seed range only pay for the generation once
+	ImGui::InputInt("Seeds to pre-generate", &seedsToPregenerate);
+	seedsToPregenerate = std::max(seedsToPregenerate, 0);
+	if (ImGui::Button("Pre-generate from seed"))
+	{
+		int first = seed ? seed : 1;
+		std::vector<WorldKey> keys;
+		for (int i = 0; i < seedsToPregenerate; i++)
+		{
+			keys.push_back(worldKey(first + i));
+		}
+		worldPregenerator.requestBatch(keys);
+	}
+	ImGui::Text("Stored worlds: %d, generating: %d", worldArchive.getEntryCount(), worldPregenerator.getPendingCount());
+
 	if (!winState.winMessage.empty())
 	{
 		ImGui::Separator();
@@ -1270,7 +1461,6 @@ bool gameLogic(float deltaTime)
 	glClear(GL_COLOR_BUFFER_BIT); //clear screen
 
 	auto fboSize = fbo.texture.GetSize();
-	fbo.clear();
 	renderer.updateWindowMetrics(fboSize.x, fboSize.y);
 
 #pragma endregion
@@ -1339,51 +1529,127 @@ bool gameLogic(float deltaTime)
 
 		#pragma region render stuff
 
-			if (currentFollow >= 0)
+			bool mapChanged = gameplayState.map.allDirty || !gameplayState.map.dirtyCells.empty();
+			auto signature = sceneSignature(fboSize);
+			bool redraw = !renderOnChange || mapChanged || signature != lastSceneSignature;
+			lastSceneSignature = signature;
+
+			if (!redraw)
 			{
-				gameplayState.map.render(renderer, spritesTexture, spritesAtlas,
-					simulateFog, {gameplayState.players[currentFollow].cameraLevel},
-					{gameplayState.players[currentFollow].position});
+				skippedRedraws++;
 			}
 			else
 			{
-				std::vector<int> view;
-				std::vector<glm::ivec2> pos;
+				//keeps the camera smooth and shows the next turn quickly
+				platform::requestFullFrameRate();
+
+				fbo.clear();
 
-				for (auto &p : gameplayState.players)
 				{
-					view.push_back(p.cameraLevel);
-					pos.push_back(p.position);
-				}
+					std::vector<int> view;
+					std::vector<glm::ivec2> pos;
 
-				gameplayState.map.render(renderer, spritesTexture, spritesAtlas,
-					simulateFog, view, pos);
-			}
+					if (currentFollow >= 0 && currentFollow < gameplayState.players.size())
+					{
+						view.push_back(gameplayState.players[currentFollow].cameraLevel);
+						pos.push_back(gameplayState.players[currentFollow].position);
+					}
+					else
+					{
+						for (auto &p : gameplayState.players)
+						{
+							view.push_back(p.cameraLevel);
+							pos.push_back(p.position);
+						}
+					}
+
+					mapCulling = {};
+					if (mapLayer.isReady())
+					{
+						mapLayer.render(renderer, gameplayState.map, spritesTexture, spritesAtlas,
+							simulateFog, view, pos, &mapCulling);
+					}
+					else
+					{
+						gameplayState.map.render(renderer, spritesTexture, spritesAtlas,
+							simulateFog, view, pos, &mapCulling);
+
+						//nothing uploads the map here, it is drawn whole every time
+						gameplayState.map.dirtyCells.clear();
+						gameplayState.map.allDirty = 0;
+					}
+				}
 
 			
 
-			for (int i = 0; i < gameplayState.players.size(); i++)
-			{
-				renderRover(renderer, roverTexture, roverAtlas, gameplayState.players[i]);
-			}
+				//zoomed out the rovers are only dots, at least a few pixels wide
+				bool roverDots = mapLayer.isReady() && TilemapLayer::isMinimapZoom(renderer);
+				float dotSize = std::max(100.f, 4.f / renderer.currentCamera.zoom);
 
-			if (renderer.currentCamera.zoom < 0.5)
-			{
-				for (int i = 0; i < gameplayState.players.size();i++)
+				roverCulling = {};
+				for (int i = 0; i < gameplayState.players.size(); i++)
 				{
-					renderer.renderText(
-						glm::vec2{gameplayState.players[i].position * 100} + glm::vec2(100, -400),
-						std::to_string(gameplayState.players[i].id).c_str(), font,
-						glm::vec4(gameplayState.players[i].color, 0.3f), 8, 4, 3, true, {0,0,0,0.1}
-					);
+					if (roverDots)
+					{
+						glm::vec2 center = glm::vec2(gameplayState.players[i].position) * 100.f + glm::vec2(50, 50);
+						glm::vec4 dot = {center - dotSize / 2.f, dotSize, dotSize};
+
+						if (isRectVisible(renderer, dot))
+						{
+							renderer.renderRectangle(dot, glm::vec4(gameplayState.players[i].color, 1));
+							roverCulling.submitted++;
+						}
+						else
+						{
+							roverCulling.culled++;
+						}
+					}
+					else if (isRectVisible(renderer, {gameplayState.players[i].position * 100, 100, 100}))
+					{
+						if (roverCache.isReady())
+						{
+							roverCache.render(renderer, gameplayState.players[i]);
+						}
+						else
+						{
+							renderRover(renderer, roverTexture, roverAtlas, gameplayState.players[i]);
+						}
+						roverCulling.submitted++;
+					}
+					else
+					{
+						roverCulling.culled++;
+					}
 				}
-			}
 
-			glViewport(0, 0, fboSize.x, fboSize.y);
-			renderer.flush();
+				if (renderer.currentCamera.zoom < 0.5)
+				{
+					for (int i = 0; i < gameplayState.players.size();i++)
+					{
+						//the label is big and sits above the rover, so the test is generous
+						if (!isRectVisible(renderer, {gameplayState.players[i].position * 100 + glm::ivec2(-500, -1000), 1500, 1500}))
+						{
+							continue;
+						}
+
+						renderer.renderText(
+							glm::vec2{gameplayState.players[i].position * 100} + glm::vec2(100, -400),
+							std::to_string(gameplayState.players[i].id).c_str(), font,
+							glm::vec4(gameplayState.players[i].color, 0.3f), 8, 4, 3, true, {0,0,0,0.1}
+						);
+					}
+				}
 
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glViewport(0, 0, w, h);
+				glViewport(0, 0, fboSize.x, fboSize.y);
+				renderer.flush();
+
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				glViewport(0, 0, w, h);
+			}
+
+			//the fbo keeps the last image when nothing was redrawn, so it can be captured either way
+			frameCapture.update(fbo, gameplayState.turnsResolved != lastCapturedTurn);
+			lastCapturedTurn = gameplayState.turnsResolved;
 
 		
 		#pragma endregion
@@ -1451,6 +1717,8 @@ bool gameLogic(float deltaTime)
 //This function might not be be called if the program is forced closed
 void closeGame()
 {
-
+	worldPregenerator.stop();
+	worldArchive.close();
+	frameCapture.cleanup();
 
 }
@@ -0,0 +1,543 @@
+#include <mapArchive.h>
+#include <mapGenerator.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static void findSpawnPoints(PregeneratedWorld &world)
+{
+	for (int j = 0; j < world.map.size.y; j++)
+	{
+		for (int i = 0; i < world.map.size.x; i++)
+		{
+			if (world.map.unsafeGet(i, j) == Tiles::Base)
+			{
+				world.spawnPoints.push_back({i,j});
+			}
+		}
+	}
+}
+
+PregeneratedWorld pregenerateWorld(WorldKey key, int threads)
+{
+	PregeneratedWorld world;
+	world.map = generate_world(key.mazeSize, key.seed, key.fewerResources, threads);
+	findSpawnPoints(world);
+	return world;
+}
+
+std::vector<PregeneratedWorld> pregenerateWorlds(glm::ivec2 mazeSize, bool fewerResources,
+	const std::vector<int> &seeds, int threads)
+{
+	std::vector<struct Map> maps = generate_worlds(mazeSize, seeds, fewerResources, threads);
+
+	std::vector<PregeneratedWorld> worlds(maps.size());
+	for (size_t i = 0; i < maps.size(); i++)
+	{
+		worlds[i].map = std::move(maps[i]);
+		findSpawnPoints(worlds[i]);
+	}
+
+	return worlds;
+}
+
+#pragma region mapped file
+
+#ifdef _WIN32
+
+bool MappedFile::map(const char *path)
+{
+	unmap();
+
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(f, &fileSize);
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(f);
+		return true;
+	}
+
+	HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!m)
+	{
+		CloseHandle(f);
+		return false;
+	}
+
+	void *view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(m);
+		CloseHandle(f);
+		return false;
+	}
+
+	fileHandle = f;
+	mappingHandle = m;
+	data = (const unsigned char *)view;
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::unmap()
+{
+	if (data) { UnmapViewOfFile(data); }
+	if (mappingHandle) { CloseHandle(mappingHandle); }
+	if (fileHandle) { CloseHandle(fileHandle); }
+	data = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	size = 0;
+}
+
+#else
+
+bool MappedFile::map(const char *path)
+{
+	unmap();
+
+	int f = ::open(path, O_RDONLY);
+	if (f < 0) { return false; }
+
+	struct stat s = {};
+	if (fstat(f, &s) != 0)
+	{
+		::close(f);
+		return false;
+	}
+
+	if (s.st_size == 0)
+	{
+		::close(f);
+		return true;
+	}
+
+	void *view = mmap(nullptr, s.st_size, PROT_READ, MAP_SHARED, f, 0);
+	::close(f); //the mapping keeps the file alive
+
+	if (view == MAP_FAILED) { return false; }
+
+	data = (const unsigned char *)view;
+	size = s.st_size;
+	return true;
+}
+
+void MappedFile::unmap()
+{
+	if (data) { munmap((void *)data, size); }
+	data = nullptr;
+	size = 0;
+}
+
+#endif
+
+#pragma endregion
+
+#pragma region archive format
+
+static const uint32_t archiveMagic = 0x43524157; //WARC
+static const uint32_t archiveVersion = 2;
+static const uint32_t entryMagic = 0x544E4557; //WENT
+
+struct ArchiveHeader
+{
+	uint32_t magic;
+	uint32_t version;          //of the file format
+	uint32_t generatorVersion; //mapGeneratorVersion the worlds were made with
+};
+
+static bool isCurrentHeader(const MappedFile &file)
+{
+	ArchiveHeader header = {};
+	if (file.size < sizeof(header)) { return false; }
+	memcpy(&header, file.data, sizeof(header));
+
+	return header.magic == archiveMagic && header.version == archiveVersion
+		&& header.generatorVersion == mapGeneratorVersion;
+}
+
+struct EntryHeader
+{
+	uint32_t magic;
+	int32_t seed;
+	int32_t mazeSizeX;
+	int32_t mazeSizeY;
+	int32_t fewerResources;
+	int32_t mapSizeX;
+	int32_t mapSizeY;
+	uint32_t spawnCount;
+	uint32_t checksum; //of everything after the header, catches half written entries
+};
+
+//the tiles fit in a nibble
+static const char tileCodes[8] = {Air, Stone, Cobble_stone, Bedrock, Iron, Osmium, Base, Acid};
+
+static unsigned char encodeTile(char t)
+{
+	for (unsigned char i = 0; i < 8; i++)
+	{
+		if (tileCodes[i] == t) { return i; }
+	}
+	return 0;
+}
+
+static size_t packedGridSize(int x, int y) { return ((size_t)x * y + 1) / 2; }
+
+static size_t entryPayloadSize(const EntryHeader &h)
+{
+	size_t s = h.spawnCount * sizeof(int32_t) * 2 + packedGridSize(h.mapSizeX, h.mapSizeY);
+	return (s + 3) & ~(size_t)3;
+}
+
+static uint32_t checksum(const unsigned char *data, size_t size)
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+	{
+		h = (h ^ data[i]) * 16777619u;
+	}
+	return h;
+}
+
+#pragma endregion
+
+bool WorldArchive::open(const std::string &path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	this->path = path;
+	index.clear();
+	validEnd = 0;
+
+	if (!std::filesystem::exists(path))
+	{
+		file.unmap();
+		return true;
+	}
+
+	remap();
+	return file.data != nullptr || file.size == 0;
+}
+
+void WorldArchive::close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	file.unmap();
+	index.clear();
+	validEnd = 0;
+}
+
+//maps the file again and indexes every entry that is whole
+void WorldArchive::remap()
+{
+	index.clear();
+	validEnd = 0;
+
+	if (!file.map(path.c_str())) { return; }
+	if (!isCurrentHeader(file)) { return; }
+
+	size_t pos = sizeof(ArchiveHeader);
+	while (size_t next = indexEntry(pos))
+	{
+		pos = next;
+	}
+
+	validEnd = pos;
+}
+
+//indexes the entry at pos if it is whole, returns where the next one starts or 0
+size_t WorldArchive::indexEntry(size_t pos)
+{
+	if (pos + sizeof(EntryHeader) > file.size) { return 0; }
+
+	EntryHeader h = {};
+	memcpy(&h, file.data + pos, sizeof(h));
+
+	if (h.magic != entryMagic || h.mapSizeX <= 0 || h.mapSizeY <= 0) { return 0; }
+
+	size_t payload = entryPayloadSize(h);
+	if (pos + sizeof(h) + payload > file.size) { return 0; }
+	if (checksum(file.data + pos + sizeof(h), payload) != h.checksum) { return 0; }
+
+	WorldKey key;
+	key.seed = h.seed;
+	key.mazeSize = {h.mazeSizeX, h.mazeSizeY};
+	key.fewerResources = h.fewerResources;
+	index[key] = pos;
+
+	return pos + sizeof(h) + payload;
+}
+
+bool WorldArchive::contains(WorldKey key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return index.find(key) != index.end();
+}
+
+bool WorldArchive::find(WorldKey key, PregeneratedWorld &world)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = index.find(key);
+	if (found == index.end()) { return false; }
+
+	const unsigned char *p = file.data + found->second;
+	EntryHeader h = {};
+	memcpy(&h, p, sizeof(h));
+	p += sizeof(h);
+
+	world.spawnPoints.resize(h.spawnCount);
+	for (auto &s : world.spawnPoints)
+	{
+		int32_t xy[2];
+		memcpy(xy, p, sizeof(xy));
+		p += sizeof(xy);
+		s = {xy[0], xy[1]};
+	}
+
+	world.map.size = {h.mapSizeX, h.mapSizeY};
+	world.map.mapData.resize((size_t)h.mapSizeX * h.mapSizeY);
+	for (size_t i = 0; i < world.map.mapData.size(); i++)
+	{
+		unsigned char b = p[i / 2];
+		world.map.mapData[i] = tileCodes[(i & 1) ? (b >> 4) : (b & 0xF)];
+	}
+
+	return true;
+}
+
+bool WorldArchive::add(WorldKey key, const PregeneratedWorld &world)
+{
+	EntryHeader h = {};
+	h.magic = entryMagic;
+	h.seed = key.seed;
+	h.mazeSizeX = key.mazeSize.x;
+	h.mazeSizeY = key.mazeSize.y;
+	h.fewerResources = key.fewerResources;
+	h.mapSizeX = world.map.size.x;
+	h.mapSizeY = world.map.size.y;
+	h.spawnCount = world.spawnPoints.size();
+
+	//build the entry before taking the lock
+	std::vector<unsigned char> payload(entryPayloadSize(h), 0);
+	unsigned char *p = payload.data();
+	for (auto s : world.spawnPoints)
+	{
+		int32_t xy[2] = {s.x, s.y};
+		memcpy(p, xy, sizeof(xy));
+		p += sizeof(xy);
+	}
+	for (size_t i = 0; i < world.map.mapData.size(); i++)
+	{
+		p[i / 2] |= encodeTile(world.map.mapData[i]) << ((i & 1) * 4);
+	}
+	h.checksum = checksum(payload.data(), payload.size());
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (index.find(key) != index.end()) { return true; }
+
+	//windows won't resize a mapped file
+	file.unmap();
+
+	std::error_code error = {};
+	if (validEnd == 0)
+	{
+		std::filesystem::remove(path, error);
+	}
+	else if (std::filesystem::file_size(path, error) != validEnd)
+	{
+		std::filesystem::resize_file(path, validEnd, error);
+	}
+
+	bool ok = 0;
+	FILE *f = fopen(path.c_str(), validEnd ? "r+b" : "wb");
+	if (f)
+	{
+		ok = 1;
+		if (validEnd == 0)
+		{
+			ArchiveHeader header = {archiveMagic, archiveVersion, mapGeneratorVersion};
+			ok &= fwrite(&header, sizeof(header), 1, f) == 1;
+		}
+		else
+		{
+			fseek(f, 0, SEEK_END);
+		}
+
+		ok &= fwrite(&h, sizeof(h), 1, f) == 1;
+		ok &= fwrite(payload.data(), payload.size(), 1, f) == 1;
+		fclose(f);
+	}
+
+	//the entries before are already indexed, only the new one is read back
+	size_t entryStart = validEnd ? validEnd : sizeof(ArchiveHeader);
+	if (!file.map(path.c_str()) || !isCurrentHeader(file))
+	{
+		index.clear();
+		validEnd = 0;
+		return false;
+	}
+
+	if (size_t next = indexEntry(entryStart)) { validEnd = next; }
+	else if (validEnd == 0) { validEnd = sizeof(ArchiveHeader); }
+
+	return ok && index.find(key) != index.end();
+}
+
+int WorldArchive::getEntryCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return index.size();
+}
+
+void WorldPregenerator::start(WorldArchive *archive)
+{
+	stop();
+
+	this->archive = archive;
+	running = 1;
+	thread = std::thread([this]() { work(); });
+}
+
+void WorldPregenerator::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = 0;
+		queue.clear();
+		batchQueue.clear();
+		pending.clear();
+	}
+	wake.notify_all();
+
+	if (thread.joinable()) { thread.join(); }
+}
+
+void WorldPregenerator::request(WorldKey key)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running || pending.find(key) != pending.end()) { return; }
+	}
+
+	if (archive->contains(key)) { return; }
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!pending.insert(key).second) { return; }
+		queue.push_back(key);
+	}
+	wake.notify_one();
+}
+
+void WorldPregenerator::requestBatch(const std::vector<WorldKey> &keys)
+{
+	std::vector<WorldKey> missing;
+	for (auto &key : keys)
+	{
+		if (!archive->contains(key)) { missing.push_back(key); }
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running) { return; }
+
+		for (auto &key : missing)
+		{
+			if (pending.insert(key).second) { batchQueue.push_back(key); }
+		}
+	}
+	wake.notify_one();
+}
+
+int WorldPregenerator::getPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending.size();
+}
+
+void WorldPregenerator::work()
+{
+	//a batch takes one world per core, small enough that single requests
+	//and stop don't wait long
+	int batchSize = std::max<int>(std::thread::hardware_concurrency(), 1);
+
+	while (true)
+	{
+		std::vector<WorldKey> keys;
+		bool batch = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return !running || !queue.empty() || !batchQueue.empty(); });
+			if (!running) { return; }
+
+			if (!queue.empty())
+			{
+				keys.push_back(queue.front());
+				queue.pop_front();
+			}
+			else
+			{
+				//generate_worlds shares the maze size across the seeds
+				batch = 1;
+				WorldKey first = batchQueue.front();
+				while (!batchQueue.empty() && (int)keys.size() < batchSize
+					&& batchQueue.front().mazeSize == first.mazeSize
+					&& batchQueue.front().fewerResources == first.fewerResources)
+				{
+					keys.push_back(batchQueue.front());
+					batchQueue.pop_front();
+				}
+			}
+		}
+
+		std::vector<int> seeds;
+		for (auto &key : keys)
+		{
+			if (!archive->contains(key)) { seeds.push_back(key.seed); }
+		}
+
+		if (!seeds.empty())
+		{
+			if (batch)
+			{
+				auto worlds = pregenerateWorlds(keys[0].mazeSize, keys[0].fewerResources, seeds, batchSize);
+				for (size_t i = 0; i < worlds.size(); i++)
+				{
+					WorldKey key = keys[0];
+					key.seed = seeds[i];
+					archive->add(key, worlds[i]);
+				}
+			}
+			else
+			{
+				//one thread only, the game is still running on the others
+				archive->add(keys[0], pregenerateWorld(keys[0], 1));
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto &key : keys)
+		{
+			pending.erase(key);
+		}
+	}
+}
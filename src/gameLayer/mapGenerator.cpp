@@ -1,167 +1,457 @@
 #include <mapGenerator.h>
+#include <mapKernels.h>
 #include <stuff.h>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstring>
 
-
-struct Map maze_map(glm::ivec2 halfsize_minus_one, char visited = Air, char not_visited = Bedrock, bool generate_borders = true, 
-	int seed = 69)
+//splits [0, rows) into bands and runs them on up to threads workers (the caller is one of them)
+static void parallel_rows(int rows, int threads, const std::function<void(int, int)> &band)
 {
-	struct Map map;
+	if (threads <= 0) { threads = std::thread::hardware_concurrency(); }
+	threads = std::max(1, std::min(threads, rows));
 
-	auto size = glm::ivec2(halfsize_minus_one.x * 2 + 1, halfsize_minus_one.y * 2 + 1);
-	map.blank(size, NotVisited);
+	if (threads == 1)
+	{
+		band(0, rows);
+		return;
+	}
+
+	//a few bands per worker so uneven rows still balance out
+	int bandSize = std::max(16, rows / (threads * 4));
+	std::atomic<int> nextRow = 0;
+
+	auto worker = [&]()
+	{
+		for (int y = nextRow.fetch_add(bandSize); y < rows; y = nextRow.fetch_add(bandSize))
+		{
+			band(y, std::min(rows, y + bandSize));
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+	{
+		workers.emplace_back(worker);
+	}
+	worker();
 
-	std::stack<glm::ivec2> cell_stack;
-	cell_stack.push(glm::ivec2(1, 1));
-	int visited_cells = 1;
+	for (auto &t : workers)
+	{
+		t.join();
+	}
+}
 
-	auto getOffset = [&](int ox, int oy)->char &
+//Cells of a maze with halfsize_minus_one cells live on the odd coordinates of the carved map
+//(or the even ones when the border is left out), walls sit between them.
+//All the carvers below keep their state in a few flat arrays sized up front,
+//so carving does no allocation per step and runs in linear time.
+struct MazeGrid
+{
+	MazeGrid(struct Map &map, glm::ivec2 cells, char visited, bool generate_borders):
+		map(map), w(cells.x), h(cells.y), visited(visited), base(generate_borders ? 1 : 0)
 	{
-		return map.unsafeGet(cell_stack.top().x + ox, cell_stack.top().y + oy);
+		visitedBits.resize((w * h + 63) / 64, 0);
 	};
 
-	auto getOffsetValue = [&](int ox, int oy)
+	struct Map &map;
+	int w = 0;
+	int h = 0;
+	char visited = Air;
+	int base = 1;
+
+	std::vector<unsigned long long> visitedBits;
+
+	enum Directions
 	{
-		return map.getValue(cell_stack.top().x + ox, cell_stack.top().y + oy);
+		north = 1,
+		west = 2,
+		south = 4,
+		east = 8,
 	};
 
-	getOffset(0, 0) = Visited;
-	std::srand(seed);
-	while (visited_cells < halfsize_minus_one.x * halfsize_minus_one.y)
+	bool isVisited(int cell) { return (visitedBits[cell >> 6] >> (cell & 63)) & 1; }
+	void markVisited(int cell) { visitedBits[cell >> 6] |= 1ull << (cell & 63); }
+
+	//directions that stay inside the maze, as a bitmask
+	int validDirections(int cell)
+	{
+		int x = cell % w;
+		int y = cell / w;
+		int dirs = 0;
+		if (y > 0) { dirs |= north; }
+		if (y < h - 1) { dirs |= south; }
+		if (x > 0) { dirs |= west; }
+		if (x < w - 1) { dirs |= east; }
+		return dirs;
+	}
+
+	int step(int cell, int dir)
 	{
-		std::vector<int> neighbours;
-		// go north
-		if (cell_stack.top().y >= 3)
+		switch (dir)
 		{
-			if (getOffsetValue(0, -2) != Visited)
-			{
-				neighbours.push_back(0);
-			}
+		case north: return cell - w;
+		case south: return cell + w;
+		case west: return cell - 1;
+		default: return cell + 1;
 		}
-		if (cell_stack.top().y <= size.y - 3)
+	}
+
+	void carveCell(int cell)
+	{
+		map.unsafeGet((cell % w) * 2 + base, (cell / w) * 2 + base) = visited;
+	}
+
+	//opens the cell and the wall towards dir
+	void carvePassage(int cell, int dir)
+	{
+		int x = (cell % w) * 2 + base;
+		int y = (cell / w) * 2 + base;
+		map.unsafeGet(x, y) = visited;
+		switch (dir)
 		{
-			if (getOffsetValue(0, 2) != Visited)
-			{
-				neighbours.push_back(2);
-			}
+		case north: map.unsafeGet(x, y - 1) = visited; break;
+		case south: map.unsafeGet(x, y + 1) = visited; break;
+		case west: map.unsafeGet(x - 1, y) = visited; break;
+		default: map.unsafeGet(x + 1, y) = visited; break;
 		}
-		if (cell_stack.top().x >= 3)
+	}
+
+	//picks one of the set bits of dirs, counting them in north, south, west, east order
+	static int pickDirection(int dirs, MapRng &rng)
+	{
+		const int order[4] = {north, south, west, east};
+		int count = ((dirs & north) != 0) + ((dirs & south) != 0) + ((dirs & west) != 0) + ((dirs & east) != 0);
+		int pick = rng.nextInt(count);
+		for (int d : order)
 		{
-			if (getOffsetValue(-2, 0) != Visited)
+			if (dirs & d)
 			{
-				neighbours.push_back(1);
+				if (!pick) { return d; }
+				pick--;
 			}
 		}
-		if (cell_stack.top().x <= size.x - 3)
+		return 0;
+	}
+};
+
+//recursive backtracker, with an explicit stack that can never grow past the cell count
+static void backtracker_maze(MazeGrid &grid, MapRng &rng)
+{
+	int cellCount = grid.w * grid.h;
+	std::vector<int> cellStack(cellCount);
+	int top = 0;
+
+	cellStack[0] = 0;
+	grid.markVisited(0);
+	grid.carveCell(0);
+	int visitedCells = 1;
+
+	while (visitedCells < cellCount)
+	{
+		int cell = cellStack[top];
+
+		int dirs = 0;
+		int valid = grid.validDirections(cell);
+		for (int d = MazeGrid::north; d <= MazeGrid::east; d <<= 1)
+		{
+			if ((valid & d) && !grid.isVisited(grid.step(cell, d))) { dirs |= d; }
+		}
+
+		if (dirs)
 		{
-			if (getOffsetValue(2, 0) != Visited)
+			int dir = MazeGrid::pickDirection(dirs, rng);
+			int next = grid.step(cell, dir);
+			grid.carvePassage(cell, dir);
+			grid.carveCell(next);
+			grid.markVisited(next);
+			cellStack[++top] = next;
+			visitedCells++;
+		}
+		else
+		{
+			top--;
+		}
+	}
+}
+
+//Wilson's algorithm: loop-erased random walks, gives an unbiased maze without the long corridors
+//of the backtracker. The walk only remembers the last direction it left each cell through,
+//which erases the loops for free.
+static void wilson_maze(MazeGrid &grid, MapRng &rng)
+{
+	int cellCount = grid.w * grid.h;
+	std::vector<unsigned char> exitDir(cellCount, 0);
+
+	grid.markVisited(0);
+	grid.carveCell(0);
+
+	for (int start = 1; start < cellCount; start++)
+	{
+		if (grid.isVisited(start)) { continue; }
+
+		int cell = start;
+		while (!grid.isVisited(cell))
+		{
+			int dir = MazeGrid::pickDirection(grid.validDirections(cell), rng);
+			exitDir[cell] = dir;
+			cell = grid.step(cell, dir);
+		}
+
+		cell = start;
+		while (!grid.isVisited(cell))
+		{
+			grid.markVisited(cell);
+			grid.carvePassage(cell, exitDir[cell]);
+			cell = grid.step(cell, exitDir[cell]);
+		}
+	}
+}
+
+//Eller's algorithm: carves one row at a time keeping only that row's sets,
+//so the memory it needs depends on the width alone.
+static void eller_maze(MazeGrid &grid, MapRng &rng)
+{
+	int w = grid.w;
+
+	//set labels are kept in [0, w) by relabeling every row
+	std::vector<int> rowSet(w);
+	std::vector<int> nextSet(w);
+	std::vector<int> parent(w);
+	std::vector<int> lastCell(w);
+	std::vector<int> remap(w);
+	std::vector<char> wentDown(w);
+
+	for (int x = 0; x < w; x++) { rowSet[x] = x; }
+
+	auto find = [&](int s)
+	{
+		while (parent[s] != s)
+		{
+			parent[s] = parent[parent[s]];
+			s = parent[s];
+		}
+		return s;
+	};
+
+	for (int y = 0; y < grid.h; y++)
+	{
+		bool lastRow = y == grid.h - 1;
+
+		for (int x = 0; x < w; x++) { parent[x] = x; }
+
+		//join neighbours that are in different sets, always on the last row
+		grid.carveCell(y * w);
+		for (int x = 0; x < w - 1; x++)
+		{
+			int a = find(rowSet[x]);
+			int b = find(rowSet[x + 1]);
+			if (a != b && (lastRow || (rng.next() & 1)))
 			{
-				neighbours.push_back(3);
+				grid.carvePassage(y * w + x, MazeGrid::east);
+				parent[b] = a;
 			}
+			grid.carveCell(y * w + x + 1);
+		}
+
+		if (lastRow) { break; }
+
+		for (int x = 0; x < w; x++)
+		{
+			rowSet[x] = find(rowSet[x]);
+			lastCell[rowSet[x]] = x;
+			wentDown[rowSet[x]] = 0;
+			remap[x] = -1;
 		}
 
-		if (!neighbours.empty())
+		//every set goes down at least once, the last cell of a set that didn't is forced to
+		int labels = 0;
+		for (int x = 0; x < w; x++)
 		{
-			// int next_cell_dir = 3;
-			int next_cell_dir = neighbours[std::rand() % neighbours.size()];
+			int s = rowSet[x];
+			bool down = (rng.next() & 1) || (lastCell[s] == x && !wentDown[s]);
 
-			switch (next_cell_dir)
+			if (down)
 			{
-			case 0:
-			getOffset(0, 0) = Visited;
-			getOffset(0, -1) = Visited;
-			cell_stack.push(glm::ivec2(cell_stack.top().x, cell_stack.top().y - 2));
-			break;
-			case 1:
-			getOffset(0, 0) = Visited;
-			getOffset(-1, 0) = Visited;
-			cell_stack.push(glm::ivec2(cell_stack.top().x - 2, cell_stack.top().y));
-			break;
-			case 2:
-			getOffset(0, 0) = Visited;
-			getOffset(0, 1) = Visited;
-			cell_stack.push(glm::ivec2(cell_stack.top().x, cell_stack.top().y + 2));
-			break;
-			case 3:
-			getOffset(0, 0) = Visited;
-			getOffset(1, 0) = Visited;
-			cell_stack.push(glm::ivec2(cell_stack.top().x + 2, cell_stack.top().y));
-			break;
+				wentDown[s] = 1;
+				grid.carvePassage(y * w + x, MazeGrid::south);
+				if (remap[s] < 0) { remap[s] = labels++; }
+				nextSet[x] = remap[s];
+			}
+			else
+			{
+				nextSet[x] = -1;
 			}
-			getOffset(0, 0) = Visited;
-			visited_cells++;
 		}
-		else
+
+		for (int x = 0; x < w; x++)
 		{
-			cell_stack.pop();
+			if (nextSet[x] < 0) { nextSet[x] = labels++; }
 		}
+
+		rowSet.swap(nextSet);
 	}
-	if (generate_borders)
+}
+
+struct Map maze_map(glm::ivec2 halfsize_minus_one, MapRng &rng, char visited = Air, char not_visited = Bedrock, 
+	bool generate_borders = true, MazeAlgorithm algorithm = MazeBacktracker)
+{
+	struct Map map;
+
+	auto size = glm::ivec2(halfsize_minus_one.x * 2 + 1, halfsize_minus_one.y * 2 + 1);
+	if (!generate_borders) { size -= 2; }
+	map.blank(size, not_visited);
+
+	if (halfsize_minus_one.x <= 0 || halfsize_minus_one.y <= 0)
+	{
+		return map;
+	}
+
+	MazeGrid grid(map, halfsize_minus_one, visited, generate_borders);
+
+	switch (algorithm)
+	{
+	case MazeWilson:
+	wilson_maze(grid, rng);
+	break;
+	case MazeEller:
+	eller_maze(grid, rng);
+	break;
+	default:
+	backtracker_maze(grid, rng);
+	break;
+	}
+
+	return map;
+}
+
+//Carves the maze in independent tiles of tile_cells x tile_cells cells on several threads,
+//then links the tiles along a random spanning tree so the result is still one perfect maze.
+struct Map tiled_maze_map(glm::ivec2 halfsize_minus_one, MapRng &rng, char visited = Air, char not_visited = Bedrock,
+	bool generate_borders = true, int threads = 0, int tile_cells = 64, MazeAlgorithm algorithm = MazeBacktracker)
+{
+	glm::ivec2 tiles = (halfsize_minus_one + tile_cells - 1) / tile_cells;
+
+	auto size = glm::ivec2(halfsize_minus_one.x * 2 + 1, halfsize_minus_one.y * 2 + 1);
+	struct Map map;
+	map.blank(size, not_visited);
+
+	//every tile gets its own generator so the result doesn't depend on the thread count
+	std::vector<MapRng> tileRng(tiles.x * tiles.y);
+	for (auto &r : tileRng)
+	{
+		r.setSeed(((unsigned long long)rng.next() << 32) | rng.next());
+	}
+
+	parallel_rows(tiles.y, threads, [&](int ty0, int ty1)
 	{
-		for (int y = 0; y < size.y; y++)
+		for (int ty = ty0; ty < ty1; ty++)
 		{
-			for (int x = 0; x < size.x; x++)
+			for (int tx = 0; tx < tiles.x; tx++)
 			{
-				if (map.getValue(x, y) == Visited)
-				{
-					map.unsafeGet(x, y) = visited;
-				}
-				else
+				glm::ivec2 start = glm::ivec2(tx, ty) * tile_cells;
+				glm::ivec2 cells = glm::min(glm::ivec2(tile_cells), halfsize_minus_one - start);
+
+				auto tile = maze_map(cells, tileRng[tx + ty * tiles.x], visited, not_visited, true, algorithm);
+
+				for (int y = 1; y < tile.size.y - 1; y++)
 				{
-					map.unsafeGet(x, y) = not_visited;
+					for (int x = 1; x < tile.size.x - 1; x++)
+					{
+						map.unsafeGet(start.x * 2 + x, start.y * 2 + y) = tile.getValue(x, y);
+					}
 				}
 			}
 		}
-		return map;
-	}
-	else
+	});
+
+	//knock one door in the wall between tiles, following a random dfs over the tile grid
+	std::vector<char> tileVisited(tiles.x * tiles.y, 0);
+	std::vector<glm::ivec2> tileStack;
+	tileStack.reserve(tiles.x * tiles.y);
+	tileStack.push_back({0, 0});
+	tileVisited[0] = 1;
+
+	while (!tileStack.empty())
 	{
-		struct Map bl_map;
-		auto bl_size = glm::ivec2(size.x - 2, size.y - 2);
-		bl_map.blank(bl_size, Air);
-		for (int y = 1; y < size.y - 1; y++)
+		glm::ivec2 t = tileStack.back();
+
+		glm::ivec2 options[4];
+		int count = 0;
+		const glm::ivec2 dirs[4] = {{0,-1}, {0,1}, {-1,0}, {1,0}};
+		for (auto d : dirs)
 		{
-			for (int x = 1; x < size.x - 1; x++)
+			glm::ivec2 n = t + d;
+			if (n.x >= 0 && n.y >= 0 && n.x < tiles.x && n.y < tiles.y && !tileVisited[n.x + n.y * tiles.x])
 			{
-				if (map.getValue(x, y) == Visited)
-				{
-					bl_map.unsafeGet(x - 1, y - 1) = visited;
-				}
-				else
-				{
-					bl_map.unsafeGet(x - 1, y - 1) = not_visited;
-				}
+				options[count++] = n;
 			}
 		}
-		return bl_map;
+
+		if (!count)
+		{
+			tileStack.pop_back();
+			continue;
+		}
+
+		glm::ivec2 n = options[rng.nextInt(count)];
+		tileVisited[n.x + n.y * tiles.x] = 1;
+		tileStack.push_back(n);
+
+		if (n.x != t.x)
+		{
+			int wallX = std::max(n.x, t.x) * tile_cells * 2;
+			int firstCell = t.y * tile_cells;
+			int cells = std::min(tile_cells, halfsize_minus_one.y - firstCell);
+			map.unsafeGet(wallX, (firstCell + rng.nextInt(cells)) * 2 + 1) = visited;
+		}
+		else
+		{
+			int wallY = std::max(n.y, t.y) * tile_cells * 2;
+			int firstCell = t.x * tile_cells;
+			int cells = std::min(tile_cells, halfsize_minus_one.x - firstCell);
+			map.unsafeGet((firstCell + rng.nextInt(cells)) * 2 + 1, wallY) = visited;
+		}
+	}
+
+	if (generate_borders)
+	{
+		return map;
+	}
+
+	struct Map bl_map;
+	bl_map.blank(size - 2, Air);
+	for (int y = 1; y < size.y - 1; y++)
+	{
+		memcpy(&bl_map.unsafeGet(0, y - 1), &map.unsafeGet(1, y), size.x - 2);
 	}
+	return bl_map;
 }
 
-struct Map simplex_map(glm::ivec2 size, FastNoiseSIMD *fn, char fill_above = Bedrock, char fill_below = Air, float threshold = 0.5, float noise_zoom = 1.0, int seed = 69)
+struct Map simplex_map(glm::ivec2 size, FastNoiseSIMD *fn, char fill_above = Bedrock, char fill_below = Air, float threshold = 0.5, float noise_zoom = 1.0, int seed = 69,
+	int threads = 1)
 {
 	struct Map map;
 	map.blank(size, fill_below);
 	fn->SetSeed(seed);
-	auto fs = fn->GetSimplexSet(0, 0, 0, size.y, size.x, 1, noise_zoom);
-	for (int y = 0; y < size.y; y++)
+
+	//noise x runs along the map rows so a band of rows is just a smaller noise set
+	parallel_rows(size.y, threads, [&](int y0, int y1)
 	{
-		for (int x = 0; x < size.x; x++)
+		auto fs = fn->GetSimplexSet(y0, 0, 0, y1 - y0, size.x, 1, noise_zoom);
+		for (int y = y0; y < y1; y++)
 		{
-			auto f = fs[x + size.x * y];
-			if (f >= threshold)
-			{
-				map.unsafeGet(x, y) = fill_above;
-			}
-			else
-			{
-				map.unsafeGet(x, y) = fill_below;
-			}
+			mapKernels::thresholdRow(&fs[size.x * (y - y0)], &map.unsafeGet(0, y), size.x,
+				threshold, fill_above, fill_below);
 		}
-	}
-	fn->FreeNoiseSet(fs);
+		fn->FreeNoiseSet(fs);
+	});
+
 	return map;
 }
 
-struct Map mask_map(struct Map *map, struct Map *mask, glm::ivec2 mask_offset, char ignore_block = Air)
+struct Map mask_map(struct Map *map, struct Map *mask, glm::ivec2 mask_offset, char ignore_block = Air, int threads = 1)
 {
 	assert(mask_offset.x >= 0);
 	assert(mask_offset.y >= 0);
@@ -169,81 +459,71 @@ struct Map mask_map(struct Map *map, struct Map *mask, glm::ivec2 mask_offset, c
 	assert(map->size.y >= mask->size.y + mask_offset.y);
 	struct Map isect;
 	isect.blank(map->size, ignore_block);
-	for (int y = 0; y < mask->size.y; y++)
+	parallel_rows(mask->size.y, threads, [&](int y0, int y1)
 	{
-		for (int x = 0; x < mask->size.x; x++)
+		for (int y = y0; y < y1; y++)
 		{
-			if (mask->getValue(x, y) != ignore_block)
-			{
-				isect.unsafeGet(x + mask_offset.x, y + mask_offset.y) = map->getValue(x + mask_offset.x, y + mask_offset.y);
-			}
+			mapKernels::maskRow(&mask->unsafeGet(0, y), &map->unsafeGet(mask_offset.x, y + mask_offset.y),
+				&isect.unsafeGet(mask_offset.x, y + mask_offset.y), mask->size.x, ignore_block);
 		}
-	}
+	});
 	return isect;
 }
 
-struct Map invert_map(struct Map *map, char old_zero = Air, char old_one = Bedrock)
+struct Map invert_map(struct Map *map, char old_zero = Air, char old_one = Bedrock, int threads = 1)
 {
 	struct Map inv;
 	inv.blank(map->size, old_zero);
-	for (int y = 0; y < inv.size.y; y++)
+	parallel_rows(inv.size.y, threads, [&](int y0, int y1)
 	{
-		for (int x = 0; x < inv.size.x; x++)
+		for (int y = y0; y < y1; y++)
 		{
-			if (map->getValue(x, y) == old_zero)
-			{
-				inv.unsafeGet(x, y) = old_one;
-			}
-			else
-			{
-				inv.unsafeGet(x, y) = old_zero;
-			}
+			mapKernels::invertRow(&map->unsafeGet(0, y), &inv.unsafeGet(0, y), inv.size.x, old_zero, old_one);
 		}
-	}
+	});
 	return inv;
 }
 
 
-struct Map additive_mask(struct Map *map, struct Map *mask, glm::ivec2 mask_offset, char ignore_block = Air)
+struct Map additive_mask(struct Map *map, struct Map *mask, glm::ivec2 mask_offset, char ignore_block = Air, int threads = 1)
 {
 	assert(mask_offset.x >= 0);
 	assert(mask_offset.y >= 0);
 	assert(map->size.x >= mask->size.x + mask_offset.x);
 	assert(map->size.y >= mask->size.y + mask_offset.y);
 	struct Map add = map->clone();
-	for (int y = 0; y < mask->size.y; y++)
+	parallel_rows(mask->size.y, threads, [&](int y0, int y1)
 	{
-		for (int x = 0; x < mask->size.x; x++)
+		for (int y = y0; y < y1; y++)
 		{
-			if (mask->getValue(x, y) != ignore_block)
-			{
-				add.unsafeGet(x + mask_offset.x, y + mask_offset.y) = mask->getValue(x + mask_offset.x, y + mask_offset.y);
-			}
+			mapKernels::additiveRow(&mask->unsafeGet(0, y), &mask->unsafeGet(mask_offset.x, y + mask_offset.y),
+				&add.unsafeGet(mask_offset.x, y + mask_offset.y), mask->size.x, ignore_block);
 		}
-	}
+	});
 	return add;
 }
 
 struct Map layered_simplex_map(glm::ivec2 size, FastNoiseSIMD *fn, char fill_above = Bedrock, char fill_below = Air, float base_threshold = 0.5, float threshold_multiplier = 0.5, 
-	float base_noise_zoom = 1.0, float zoom_multiplier = 0.5, int octaves = 2, int seed = 69)
+	float base_noise_zoom = 1.0, float zoom_multiplier = 0.5, int octaves = 2, int seed = 69, int threads = 1)
 {
 	assert(octaves >= 1);
 	auto threshold = base_threshold;
 	auto zoom = base_noise_zoom;
 	int i = 0;
-	auto lsm = simplex_map(size, fn, fill_above, fill_below, threshold, zoom, seed);
+	auto lsm = simplex_map(size, fn, fill_above, fill_below, threshold, zoom, seed, threads);
 	while (i < octaves)
 	{
 		threshold *= threshold_multiplier;
 		zoom *= zoom_multiplier;
-		auto lsm_to_add = simplex_map(size, fn, fill_above, fill_below, threshold, zoom, seed);
-		lsm = additive_mask(&lsm, &lsm_to_add, glm::ivec2(0, 0), fill_below);
+		auto lsm_to_add = simplex_map(size, fn, fill_above, fill_below, threshold, zoom, seed, threads);
+		lsm = additive_mask(&lsm, &lsm_to_add, glm::ivec2(0, 0), fill_below, threads);
 		i++;
 	}
 	return lsm;
 }
 
-struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources)
+struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources, int threads, bool tiledMaze,
+	MazeAlgorithm mazeAlgorithm)
 {
 	auto addSpawn = [&](int x, int y, Map &m)
 	{
@@ -259,28 +539,36 @@ struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources)
 		m.safeSet(x, y, Base);
 	};
 
-	srand(seed);
+	MapRng rng(seed);
 
 	auto fn = FastNoiseSIMD::NewFastNoiseSIMD();
 
-	auto m1 = maze_map(maze_size, Air, Stone, false);
+	struct Map m1;
+	if (tiledMaze)
+	{
+		m1 = tiled_maze_map(maze_size, rng, Air, Stone, false, threads, 64, mazeAlgorithm);
+	}
+	else
+	{
+		m1 = maze_map(maze_size, rng, Air, Stone, false, mazeAlgorithm);
+	}
 
 	auto s_size = m1.size;
 
-	auto lab_holes = layered_simplex_map(s_size, fn, Stone, Air, 0.5, 0.95, 3, 2, 2, seed + 2);
-	auto lab_bedrock = layered_simplex_map(s_size, fn, Bedrock, Air, 0.75, 0.90, 3, 2, 2, seed + 7);
+	auto lab_holes = layered_simplex_map(s_size, fn, Stone, Air, 0.5, 0.95, 3, 2, 2, seed + 2, threads);
+	auto lab_bedrock = layered_simplex_map(s_size, fn, Bedrock, Air, 0.75, 0.90, 3, 2, 2, seed + 7, threads);
 
-	auto extraRock = layered_simplex_map(s_size, fn, Stone, Air, 0.6, 0.95, 3, 2, 2, seed + 3);
+	auto extraRock = layered_simplex_map(s_size, fn, Stone, Air, 0.6, 0.95, 3, 2, 2, seed + 3, threads);
 
-	auto maze_with_holes = mask_map(&m1, &lab_holes, glm::ivec2(0, 0), Air);
-	auto maze_with_bedrock = mask_map(&lab_bedrock, &maze_with_holes, glm::ivec2(0, 0), Air);
+	auto maze_with_holes = mask_map(&m1, &lab_holes, glm::ivec2(0, 0), Air, threads);
+	auto maze_with_bedrock = mask_map(&lab_bedrock, &maze_with_holes, glm::ivec2(0, 0), Air, threads);
 
-	maze_with_bedrock = additive_mask(&maze_with_bedrock, &extraRock, glm::ivec2(0, 0), Air);
-	maze_with_bedrock = additive_mask(&maze_with_holes, &maze_with_bedrock, {}, Air);
+	maze_with_bedrock = additive_mask(&maze_with_bedrock, &extraRock, glm::ivec2(0, 0), Air, threads);
+	maze_with_bedrock = additive_mask(&maze_with_holes, &maze_with_bedrock, {}, Air, threads);
 
 	float baseIronTresshold = 0.975;
 	if (fewerResources) { baseIronTresshold = 1; }
-	auto random_iron = layered_simplex_map(s_size, fn, Iron, Air, baseIronTresshold, 0.975, 8, 2, 4, seed + 1);
+	auto random_iron = layered_simplex_map(s_size, fn, Iron, Air, baseIronTresshold, 0.975, 8, 2, 4, seed + 1, threads);
 	
 	Map cobaltMap;
 	cobaltMap.blank(s_size, Air);
@@ -290,8 +578,8 @@ struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources)
 	{
 		for (int i = 0; i < s_size.x; i+= advance)
 		{
-			int offsetX = rand() % advance;
-			int offsetY = rand() % advance;
+			int offsetX = rng.nextInt(advance);
+			int offsetY = rng.nextInt(advance);
 
 			cobaltMap.safeSet(i + offsetX, j + offsetY, Tiles::Osmium);
 
@@ -306,9 +594,11 @@ struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources)
 	//auto random_cobalt = layered_simplex_map(s_size, fn, Tiles::Osmium, Air, 0.99, 0.993, 9, 2, 8);
 	//random_cobalt = additive_mask(&cobalt_stone, &random_cobalt, glm::ivec2(0, 0), Air);
 
-	auto final_map = additive_mask(&maze_with_bedrock, &random_iron, glm::ivec2(0, 0), Air);
-	final_map = additive_mask(&final_map, &random_iron, glm::ivec2(0, 0), Air);
-	final_map = additive_mask(&final_map, &cobaltMap, glm::ivec2(0, 0), Air);
+	delete fn;
+
+	auto final_map = additive_mask(&maze_with_bedrock, &random_iron, glm::ivec2(0, 0), Air, threads);
+	final_map = additive_mask(&final_map, &random_iron, glm::ivec2(0, 0), Air, threads);
+	final_map = additive_mask(&final_map, &cobaltMap, glm::ivec2(0, 0), Air, threads);
 
 	std::vector<glm::vec2> positions;
 
@@ -342,5 +632,37 @@ struct Map generate_world(glm::ivec2 maze_size, int seed, bool fewerResources)
 	return final_map;
 }
 
+std::vector<struct Map> generate_worlds(glm::ivec2 maze_size, const std::vector<int> &seeds, bool fewerResources,
+	int threads)
+{
+	std::vector<struct Map> worlds(seeds.size());
+
+	if (threads <= 0) { threads = std::thread::hardware_concurrency(); }
+	threads = std::max(1, std::min<int>(threads, seeds.size()));
 
+	//the simd level is detected lazily, do it once before the workers race for it
+	FastNoiseSIMD::GetSIMDLevel();
 
+	std::atomic<int> nextSeed = 0;
+	auto worker = [&]()
+	{
+		for (int i = nextSeed++; i < (int)seeds.size(); i = nextSeed++)
+		{
+			worlds[i] = generate_world(maze_size, seeds[i], fewerResources);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+	{
+		workers.emplace_back(worker);
+	}
+	worker();
+
+	for (auto &t : workers)
+	{
+		t.join();
+	}
+
+	return worlds;
+}
@@ -0,0 +1,270 @@
+#include <mapKernels.h>
+#include <FastNoiseSIMD.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MAP_KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define MAP_KERNELS_X86 0
+#endif
+
+//gcc and clang only emit avx2 inside functions marked for it, msvc always can
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MAP_KERNELS_AVX2
+#else
+#define MAP_KERNELS_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace mapKernels
+{
+
+#pragma region scalar
+
+	static void thresholdRowScalar(const float *in, char *out, int count, float threshold, char above, char below)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			out[i] = in[i] >= threshold ? above : below;
+		}
+	}
+
+	static void maskRowScalar(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			out[i] = test[i] != ignore ? value[i] : ignore;
+		}
+	}
+
+	static void additiveRowScalar(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (test[i] != ignore) { out[i] = value[i]; }
+		}
+	}
+
+	static void invertRowScalar(const char *in, char *out, int count, char zero, char one)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			out[i] = in[i] == zero ? one : zero;
+		}
+	}
+
+#pragma endregion
+
+#if MAP_KERNELS_X86
+
+#pragma region sse2
+
+	static void thresholdRowSSE2(const float *in, char *out, int count, float threshold, char above, char below)
+	{
+		const __m128 t = _mm_set1_ps(threshold);
+		const __m128i a = _mm_set1_epi8(above);
+		const __m128i b = _mm_set1_epi8(below);
+
+		int i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i m0 = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(in + i), t));
+			__m128i m1 = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(in + i + 4), t));
+			__m128i m2 = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(in + i + 8), t));
+			__m128i m3 = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(in + i + 12), t));
+
+			//all ones / all zeros lanes survive the saturating packs
+			__m128i m = _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+
+			_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)));
+		}
+
+		thresholdRowScalar(in + i, out + i, count - i, threshold, above, below);
+	}
+
+	static void maskRowSSE2(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		const __m128i ig = _mm_set1_epi8(ignore);
+
+		int i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i skip = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(test + i)), ig);
+			__m128i v = _mm_loadu_si128((const __m128i *)(value + i));
+			_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(_mm_and_si128(skip, ig), _mm_andnot_si128(skip, v)));
+		}
+
+		maskRowScalar(test + i, value + i, out + i, count - i, ignore);
+	}
+
+	static void additiveRowSSE2(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		const __m128i ig = _mm_set1_epi8(ignore);
+
+		int i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i skip = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(test + i)), ig);
+			__m128i v = _mm_loadu_si128((const __m128i *)(value + i));
+			__m128i o = _mm_loadu_si128((const __m128i *)(out + i));
+			_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(_mm_and_si128(skip, o), _mm_andnot_si128(skip, v)));
+		}
+
+		additiveRowScalar(test + i, value + i, out + i, count - i, ignore);
+	}
+
+	static void invertRowSSE2(const char *in, char *out, int count, char zero, char one)
+	{
+		const __m128i z = _mm_set1_epi8(zero);
+		const __m128i o = _mm_set1_epi8(one);
+
+		int i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i isZero = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(in + i)), z);
+			_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(_mm_and_si128(isZero, o), _mm_andnot_si128(isZero, z)));
+		}
+
+		invertRowScalar(in + i, out + i, count - i, zero, one);
+	}
+
+#pragma endregion
+
+#pragma region avx2
+
+	MAP_KERNELS_AVX2 static void thresholdRowAVX2(const float *in, char *out, int count, float threshold, char above, char below)
+	{
+		const __m256 t = _mm256_set1_ps(threshold);
+		const __m256i a = _mm256_set1_epi8(above);
+		const __m256i b = _mm256_set1_epi8(below);
+
+		//the packs work per 128 bit lane, this puts the dwords back in order
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+		int i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i m0 = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(in + i), t, _CMP_GE_OQ));
+			__m256i m1 = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(in + i + 8), t, _CMP_GE_OQ));
+			__m256i m2 = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(in + i + 16), t, _CMP_GE_OQ));
+			__m256i m3 = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(in + i + 24), t, _CMP_GE_OQ));
+
+			__m256i m = _mm256_packs_epi16(_mm256_packs_epi32(m0, m1), _mm256_packs_epi32(m2, m3));
+			m = _mm256_permutevar8x32_epi32(m, order);
+
+			_mm256_storeu_si256((__m256i *)(out + i), _mm256_blendv_epi8(b, a, m));
+		}
+
+		thresholdRowSSE2(in + i, out + i, count - i, threshold, above, below);
+	}
+
+	MAP_KERNELS_AVX2 static void maskRowAVX2(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		const __m256i ig = _mm256_set1_epi8(ignore);
+
+		int i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i skip = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(test + i)), ig);
+			__m256i v = _mm256_loadu_si256((const __m256i *)(value + i));
+			_mm256_storeu_si256((__m256i *)(out + i), _mm256_blendv_epi8(v, ig, skip));
+		}
+
+		maskRowSSE2(test + i, value + i, out + i, count - i, ignore);
+	}
+
+	MAP_KERNELS_AVX2 static void additiveRowAVX2(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		const __m256i ig = _mm256_set1_epi8(ignore);
+
+		int i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i skip = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(test + i)), ig);
+			__m256i v = _mm256_loadu_si256((const __m256i *)(value + i));
+			__m256i o = _mm256_loadu_si256((const __m256i *)(out + i));
+			_mm256_storeu_si256((__m256i *)(out + i), _mm256_blendv_epi8(v, o, skip));
+		}
+
+		additiveRowSSE2(test + i, value + i, out + i, count - i, ignore);
+	}
+
+	MAP_KERNELS_AVX2 static void invertRowAVX2(const char *in, char *out, int count, char zero, char one)
+	{
+		const __m256i z = _mm256_set1_epi8(zero);
+		const __m256i o = _mm256_set1_epi8(one);
+
+		int i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i isZero = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(in + i)), z);
+			_mm256_storeu_si256((__m256i *)(out + i), _mm256_blendv_epi8(z, o, isZero));
+		}
+
+		invertRowSSE2(in + i, out + i, count - i, zero, one);
+	}
+
+#pragma endregion
+
+#endif
+
+	struct KernelSet
+	{
+		decltype(&thresholdRowScalar) thresholdRow = thresholdRowScalar;
+		decltype(&maskRowScalar) maskRow = maskRowScalar;
+		decltype(&additiveRowScalar) additiveRow = additiveRowScalar;
+		decltype(&invertRowScalar) invertRow = invertRowScalar;
+		const char *name = "scalar";
+	};
+
+	static KernelSet pickKernels()
+	{
+		KernelSet k;
+
+	#if MAP_KERNELS_X86
+		int level = FastNoiseSIMD::GetSIMDLevel();
+
+		if (level >= FN_AVX2 && level != FN_NEON)
+		{
+			k = {thresholdRowAVX2, maskRowAVX2, additiveRowAVX2, invertRowAVX2, "avx2"};
+		}
+		else if (level >= FN_SSE2 && level != FN_NEON)
+		{
+			k = {thresholdRowSSE2, maskRowSSE2, additiveRowSSE2, invertRowSSE2, "sse2"};
+		}
+	#endif
+
+		return k;
+	}
+
+	static const KernelSet &kernels()
+	{
+		static const KernelSet k = pickKernels();
+		return k;
+	}
+
+	void thresholdRow(const float *in, char *out, int count, float threshold, char above, char below)
+	{
+		kernels().thresholdRow(in, out, count, threshold, above, below);
+	}
+
+	void maskRow(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		kernels().maskRow(test, value, out, count, ignore);
+	}
+
+	void additiveRow(const char *test, const char *value, char *out, int count, char ignore)
+	{
+		kernels().additiveRow(test, value, out, count, ignore);
+	}
+
+	void invertRow(const char *in, char *out, int count, char zero, char one)
+	{
+		kernels().invertRow(in, out, count, zero, one);
+	}
+
+	const char *getKernelName()
+	{
+		return kernels().name;
+	}
+
+};
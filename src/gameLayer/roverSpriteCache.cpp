@@ -0,0 +1,217 @@
+#include <roverSpriteCache.h>
+
+//for the pass that turns the composed cell back into straight alpha
+static const char *copyVertexShader =
+	GL2D_OPNEGL_SHADER_VERSION "\n"
+	"in vec2 quad_positions;\n"
+	"in vec4 quad_colors;\n"
+	"in vec2 texturePositions;\n"
+	"out vec2 v_texture;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(quad_positions, 0, 1);\n"
+	"	v_texture = texturePositions;\n"
+	"}\n";
+
+static const char *unpremultiplyFragmentShader =
+	GL2D_OPNEGL_SHADER_VERSION "\n"
+	"in vec2 v_texture;\n"
+	"out vec4 color;\n"
+	"uniform sampler2D u_sampler;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 t = texture(u_sampler, v_texture);\n"
+	"	color = t.a > 0 ? vec4(t.rgb / t.a, t.a) : vec4(0);\n"
+	"}\n";
+
+RoverLook::RoverLook(const Player &player)
+{
+	glm::ivec3 c = glm::ivec3(glm::clamp(player.color, 0.f, 1.f) * 255.f + 0.5f);
+	color = c.r | (c.g << 8) | (c.b << 16);
+	gunLevel = player.gunLevel;
+	drilLevel = player.drilLevel;
+	wheelLevel = player.wheelLevel;
+	cameraLevel = player.cameraLevel;
+	hasAntena = player.hasAntena;
+	hasBatery = player.hasBatery;
+}
+
+void RoverSpriteCache::create(gl2d::Texture &roverTexture, gl2d::TextureAtlasPadding &roverAtlas)
+{
+	cleanup();
+
+	this->roverTexture = &roverTexture;
+	this->roverAtlas = &roverAtlas;
+
+	int size = CELL_SIZE * CELLS_PER_ROW;
+	frameBuffer.create(size, size);
+
+	//the rover atlas is pixelated, keep it that way
+	glBindTexture(GL_TEXTURE_2D, frameBuffer.texture.id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	composer.create(frameBuffer.fbo, 16);
+	composer.updateWindowMetrics(size, size);
+
+	scratch.createFromBuffer(nullptr, CELL_SIZE, CELL_SIZE, true, false);
+	unpremultiplyShader = gl2d::createShaderProgram(copyVertexShader, unpremultiplyFragmentShader);
+
+	//without it the cells would draw too dark, renderRover is used instead
+	GLint linked = 0;
+	glGetProgramiv(unpremultiplyShader.id, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		cleanup();
+		return;
+	}
+
+	cellLooks.resize(CELLS_PER_ROW * CELLS_PER_ROW);
+	cellLastUse.resize(CELLS_PER_ROW * CELLS_PER_ROW);
+}
+
+void RoverSpriteCache::cleanup()
+{
+	if (frameBuffer.fbo)
+	{
+		composer.cleanup();
+		frameBuffer.cleanup();
+		scratch.cleanup();
+		glDeleteProgram(unpremultiplyShader.id);
+	}
+	frameBuffer = {};
+	scratch = {};
+	unpremultiplyShader = {};
+
+	cells.clear();
+	cellLooks.clear();
+	cellLastUse.clear();
+	useCounter = 0;
+	composedCount = 0;
+}
+
+glm::vec4 RoverSpriteCache::cellTextureCoords(int cell)
+{
+	float size = CELL_SIZE * CELLS_PER_ROW;
+	glm::vec2 min = glm::vec2(cell % CELLS_PER_ROW, cell / CELLS_PER_ROW) * (float)CELL_SIZE / size;
+	glm::vec2 max = min + glm::vec2(CELL_SIZE / size);
+
+	//the top of the screen is the top of the texture
+	return {min.x, 1.f - min.y, max.x, 1.f - max.y};
+}
+
+int RoverSpriteCache::getCell(const RoverLook &look)
+{
+	useCounter++;
+
+	auto found = cells.find(look);
+	if (found != cells.end())
+	{
+		cellLastUse[found->second] = useCounter;
+		return found->second;
+	}
+
+	int cell = 0;
+	if (cells.size() < cellLooks.size())
+	{
+		cell = cells.size();
+	}
+	else
+	{
+		for (int i = 1; i < (int)cellLastUse.size(); i++)
+		{
+			if (cellLastUse[i] < cellLastUse[cell]) { cell = i; }
+		}
+		cells.erase(cellLooks[cell]);
+	}
+
+	compose(cell, look);
+
+	cells[look] = cell;
+	cellLooks[cell] = look;
+	cellLastUse[cell] = useCounter;
+
+	return cell;
+}
+
+//the layers of renderRover, in the same order
+void RoverSpriteCache::compose(int cell, const RoverLook &look)
+{
+	GLint previousFbo = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+
+	glm::vec2 pos = glm::vec2(cell % CELLS_PER_ROW, cell / CELLS_PER_ROW) * (float)CELL_SIZE;
+	glm::vec2 size(CELL_SIZE, CELL_SIZE);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer.fbo);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(pos.x, CELL_SIZE * CELLS_PER_ROW - pos.y - CELL_SIZE, CELL_SIZE, CELL_SIZE);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+
+	glm::vec4 color(
+		(look.color & 0xFF) / 255.f, ((look.color >> 8) & 0xFF) / 255.f, ((look.color >> 16) & 0xFF) / 255.f, 1);
+
+	auto &texture = *roverTexture;
+	auto &atlas = *roverAtlas;
+
+	composer.renderRectangle({pos, size}, texture, color, {}, 0, atlas.get(0, 0));
+	composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(1, 0));
+	composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(look.gunLevel - 1, 3));
+
+	if (look.hasAntena)
+	{
+		composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(2, 0));
+	}
+
+	if (look.hasBatery)
+	{
+		composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(3, 0));
+	}
+
+	composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(look.drilLevel - 1, 2));
+	composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(look.wheelLevel - 1, 1));
+	composer.renderRectangle({pos, size}, texture, Colors_White, {}, 0, atlas.get(look.cameraLevel - 1, 4));
+
+	gl2d::enableNecessaryGLFeatures();
+	composer.flush();
+
+	//The layers were blended over transparent black, so the cell holds colors multiplied by
+	//alpha and drawing it with straight alpha blending would darken the soft edges.
+	//Copy it out and write it back divided by alpha, without blending
+	glBindTexture(GL_TEXTURE_2D, scratch.id);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+		pos.x, CELL_SIZE * CELLS_PER_ROW - pos.y - CELL_SIZE, CELL_SIZE, CELL_SIZE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	composer.pushShader(unpremultiplyShader);
+	composer.renderRectangle({pos, size}, scratch, Colors_White);
+	glDisable(GL_BLEND);
+	composer.flush();
+	gl2d::enableNecessaryGLFeatures();
+	composer.popShader();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+	composedCount++;
+}
+
+void RoverSpriteCache::render(gl2d::Renderer2D &renderer, Player &player)
+{
+	if (!isReady()) { return; }
+
+	glm::vec2 pos = player.position * 100;
+	glm::vec2 size(100, 100);
+
+	float lifeFloat = (float)player.life / MAX_ROVER_LIFE;
+
+	renderer.renderRectangle({pos,size.x * 1,10}, Colors_Black);
+	renderer.renderRectangle({pos,size.x * lifeFloat,10}, Colors_Red);
+
+	int cell = getCell(RoverLook(player));
+
+	renderer.renderRectangle({pos,size}, frameBuffer.texture, Colors_White, {}, 0, cellTextureCoords(cell));
+}
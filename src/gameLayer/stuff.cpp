@@ -1,13 +1,63 @@
 #include <stuff.h>
 
-bool calculateView(glm::ivec2 playerPos, glm::ivec2 blockPos, int level)
+float viewRadius(int level)
 {
+	if (level == 1) { return std::sqrt(5.f) + 0.1; }
+	if (level == 2) { return std::sqrt(12.f) + 0.1; }
+	if (level == 3) { return std::sqrt(20.f) + 0.1; }
+
+	return 0;
+}
 
-	if (level == 1) { return glm::distance(glm::vec2(playerPos), glm::vec2(blockPos)) < std::sqrt(5.f) + 0.1; }
-	if (level == 2) { return glm::distance(glm::vec2(playerPos), glm::vec2(blockPos)) < std::sqrt(12.f) + 0.1; }
-	if (level == 3) { return glm::distance(glm::vec2(playerPos), glm::vec2(blockPos)) < std::sqrt(20.f) + 0.1; }
+bool calculateView(glm::ivec2 playerPos, glm::ivec2 blockPos, int level)
+{
+	return glm::distance(glm::vec2(playerPos), glm::vec2(blockPos)) < viewRadius(level);
+}
 
+int tileAtlasIndex(char tile)
+{
+	switch (tile)
+	{
+	case Air:
 	return 0;
+	case Stone:
+	return 1;
+	case Cobble_stone:
+	return 2;
+	case Bedrock:
+	return 5;
+	case Osmium:
+	return 4;
+	case Iron:
+	return 3;
+	case Base:
+	return 6;
+	case Acid:
+	return 7;
+
+	default: return 9;
+	}
+}
+
+bool isRectVisible(gl2d::Renderer2D &renderer, glm::vec4 rect)
+{
+	glm::vec4 view = renderer.getViewRect();
+
+	return rect.x < view.x + view.z && rect.x + rect.z > view.x
+		&& rect.y < view.y + view.w && rect.y + rect.w > view.y;
+}
+
+glm::ivec4 visibleTiles(gl2d::Renderer2D &renderer, glm::ivec2 mapSize, float tileSize)
+{
+	glm::vec4 view = renderer.getViewRect();
+
+	glm::ivec2 minTile = glm::floor(glm::vec2(view.x, view.y) / tileSize);
+	glm::ivec2 maxTile = glm::floor(glm::vec2(view.x + view.z, view.y + view.w) / tileSize) + 1.f;
+
+	minTile = glm::clamp(minTile, glm::ivec2(0), mapSize);
+	maxTile = glm::clamp(maxTile, minTile, mapSize);
+
+	return {minTile, maxTile};
 }
 
 void renderRover(gl2d::Renderer2D &renderer, 
@@ -57,6 +107,29 @@ void renderRover(gl2d::Renderer2D &renderer,
 
 }
 
+unsigned long long Player::hash() const
+{
+	unsigned long long values[] =
+	{
+		(unsigned long long)position.x, (unsigned long long)position.y,
+		(unsigned long long)life, hasAntena, hasBatery,
+		(unsigned long long)wheelLevel, (unsigned long long)cameraLevel,
+		(unsigned long long)gunLevel, (unsigned long long)drilLevel,
+		(unsigned long long)scannedThisTurn,
+		(unsigned long long)stones, (unsigned long long)iron, (unsigned long long)osmium,
+		(unsigned long long)currentRound,
+		(unsigned long long)spawnPoint.x, (unsigned long long)spawnPoint.y,
+	};
+
+	//the rover's id and the field pick the key
+	unsigned long long h = 0;
+	for (unsigned long long i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		h ^= zobristKey(ZobristRover, (unsigned long long)id * 32 + i, values[i]);
+	}
+	return h;
+}
+
 void renderRover(gl2d::Renderer2D &renderer, gl2d::Texture &roverTexture, 
 	gl2d::TextureAtlasPadding &roverAtlas, Player &player)
 {
@@ -75,41 +148,25 @@ struct Map splat(glm::ivec2 size)
 
 void Map::render(gl2d::Renderer2D & renderer, gl2d::Texture & tiles,
 	gl2d::TextureAtlasPadding &tilesAtlas, bool simulateFog,
-	std::vector<int> viewLevel, std::vector<glm::ivec2> playerPos)
+	std::vector<int> viewLevel, std::vector<glm::ivec2> playerPos, CullingStats *stats)
 {
 
 	glm::vec2 drawSize(100, 100);
 
+	glm::ivec4 visible = visibleTiles(renderer, size, drawSize.x);
 
+	if (stats)
+	{
+		int drawn = (visible.z - visible.x) * (visible.w - visible.y);
+		stats->submitted += drawn;
+		stats->culled += size.x * size.y - drawn;
+	}
 
-	for (int j = 0; j < size.y; j++)
+	for (int j = visible.y; j < visible.w; j++)
 	{
-		for (int i = 0; i < size.x; i++)
+		for (int i = visible.x; i < visible.z; i++)
 		{
-			int tileType = 0;
-
-			switch (unsafeGet({i,j}))
-			{
-			case Air:
-			tileType = 0; break;
-			case Stone:
-			tileType = 1; break;
-			case Cobble_stone:
-			tileType = 2; break;
-			case Bedrock:
-			tileType = 5; break;
-			case Osmium:
-			tileType = 4; break;
-			case Iron:
-			tileType = 3; break;
-			case Base:
-			tileType = 6; break;
-			case Acid:
-			tileType = 7; break;
-
-
-			default: tileType = 9;
-			}
+			int tileType = tileAtlasIndex(unsafeGet({i,j}));
 
 			glm::vec4 color = Colors_White;
 
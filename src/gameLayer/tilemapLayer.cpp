@@ -0,0 +1,316 @@
+#include <tilemapLayer.h>
+#include <algorithm>
+
+static const char *tilemapVertexShader =
+	GL2D_OPNEGL_SHADER_VERSION "\n"
+	"layout(location = 0) in vec2 corner;\n"
+	"uniform vec4 u_screenRect;\n" //top left, bottom right in clip space
+	"uniform vec4 u_mapRect;\n" //the same corners in tiles
+	"out vec2 v_mapPos;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(mix(u_screenRect.xy, u_screenRect.zw, corner), 0, 1);\n"
+	"	v_mapPos = mix(u_mapRect.xy, u_mapRect.zw, corner);\n"
+	"}\n";
+
+//darkens the cells no player sees
+#define TILEMAP_FOG_GLSL \
+	"uniform int u_fog;\n" \
+	"uniform int u_playerCount;\n" \
+	"uniform vec2 u_playerPos[8];\n" \
+	"uniform float u_viewRadius[8];\n" \
+	"vec4 applyFog(vec4 color, ivec2 cell)\n" \
+	"{\n" \
+	"	if (u_fog == 0) { return color; }\n" \
+	"	for (int i = 0; i < u_playerCount; i++)\n" \
+	"	{\n" \
+	"		if (distance(vec2(cell), u_playerPos[i]) < u_viewRadius[i]) { return color; }\n" \
+	"	}\n" \
+	"	return vec4(color.rgb * 0.5, color.a);\n" \
+	"}\n"
+
+static const char *tilemapFragmentShader =
+	GL2D_OPNEGL_SHADER_VERSION "\n"
+	"in vec2 v_mapPos;\n"
+	"out vec4 color;\n"
+	"uniform sampler2D u_sampler;\n"
+	"uniform usampler2D u_tiles;\n"
+	"uniform vec4 u_atlasRects[10];\n"
+	TILEMAP_FOG_GLSL
+	"void main()\n"
+	"{\n"
+	"	ivec2 cell = ivec2(floor(v_mapPos));\n"
+	"	vec4 rect = u_atlasRects[int(min(texelFetch(u_tiles, cell, 0).r, 9u))];\n"
+	//the gradients come from the continuous position, fract would jump at every tile edge
+	"	vec2 grad = rect.zw - rect.xy;\n"
+	"	vec2 uv = rect.xy + fract(v_mapPos) * grad;\n"
+	"	color = applyFog(textureGrad(u_sampler, uv, dFdx(v_mapPos) * grad, dFdy(v_mapPos) * grad), cell);\n"
+	"}\n";
+
+static const char *minimapFragmentShader =
+	GL2D_OPNEGL_SHADER_VERSION "\n"
+	"in vec2 v_mapPos;\n"
+	"out vec4 color;\n"
+	"uniform usampler2D u_tiles;\n"
+	"uniform vec4 u_tileColors[10];\n"
+	TILEMAP_FOG_GLSL
+	"void main()\n"
+	"{\n"
+	"	ivec2 cell = ivec2(floor(v_mapPos));\n"
+	"	color = applyFog(u_tileColors[int(min(texelFetch(u_tiles, cell, 0).r, 9u))], cell);\n"
+	"}\n";
+
+bool TilemapLayer::Program::create(const char *fragmentShader)
+{
+	auto shader = gl2d::createShaderProgram(tilemapVertexShader, fragmentShader);
+
+	GLint linked = 0;
+	glGetProgramiv(shader.id, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		glDeleteProgram(shader.id);
+		return false;
+	}
+
+	id = shader.id;
+
+	u_screenRect = glGetUniformLocation(id, "u_screenRect");
+	u_mapRect = glGetUniformLocation(id, "u_mapRect");
+	u_sampler = glGetUniformLocation(id, "u_sampler");
+	u_tiles = glGetUniformLocation(id, "u_tiles");
+	u_atlasRects = glGetUniformLocation(id, "u_atlasRects");
+	u_tileColors = glGetUniformLocation(id, "u_tileColors");
+	u_fog = glGetUniformLocation(id, "u_fog");
+	u_playerCount = glGetUniformLocation(id, "u_playerCount");
+	u_playerPos = glGetUniformLocation(id, "u_playerPos");
+	u_viewRadius = glGetUniformLocation(id, "u_viewRadius");
+
+	return true;
+}
+
+bool TilemapLayer::create()
+{
+	cleanup();
+
+	if (!tilesProgram.create(tilemapFragmentShader))
+	{
+		return false;
+	}
+
+	//without it the zoomed out view just keeps the sprites
+	minimapProgram.create(minimapFragmentShader);
+
+	const float corners[] = {0,0, 0,1, 1,0, 1,1};
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+	glBindVertexArray(0);
+
+	glGenTextures(1, &tileTexture);
+	glBindTexture(GL_TEXTURE_2D, tileTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	textureSize = {};
+
+	return true;
+}
+
+void TilemapLayer::cleanup()
+{
+	if (tilesProgram.id) { glDeleteProgram(tilesProgram.id); }
+	if (minimapProgram.id) { glDeleteProgram(minimapProgram.id); }
+	if (vbo) { glDeleteBuffers(1, &vbo); }
+	if (vao) { glDeleteVertexArrays(1, &vao); }
+	if (tileTexture) { glDeleteTextures(1, &tileTexture); }
+	tilesProgram = {};
+	minimapProgram = {};
+	tileColorsTexture = 0;
+	vbo = 0;
+	vao = 0;
+	tileTexture = 0;
+	textureSize = {};
+}
+
+void TilemapLayer::update(Map &map)
+{
+	if (!isReady() || map.size.x <= 0 || map.size.y <= 0) { return; }
+
+	glBindTexture(GL_TEXTURE_2D, tileTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	//past this many cells one upload of everything is cheaper than many small ones
+	size_t fullUploadThreshold = std::max<size_t>(64, map.mapData.size() / 8);
+
+	if (map.allDirty || map.size != textureSize || map.dirtyCells.size() > fullUploadThreshold)
+	{
+		uploadBuffer.resize(map.mapData.size());
+		for (size_t i = 0; i < map.mapData.size(); i++)
+		{
+			uploadBuffer[i] = tileAtlasIndex(map.mapData[i]);
+		}
+
+		if (map.size != textureSize)
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, map.size.x, map.size.y, 0,
+				GL_RED_INTEGER, GL_UNSIGNED_BYTE, uploadBuffer.data());
+			textureSize = map.size;
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, map.size.x, map.size.y,
+				GL_RED_INTEGER, GL_UNSIGNED_BYTE, uploadBuffer.data());
+		}
+	}
+	else
+	{
+		for (auto c : map.dirtyCells)
+		{
+			unsigned char index = tileAtlasIndex(map.unsafeGet(c));
+			glTexSubImage2D(GL_TEXTURE_2D, 0, c.x, c.y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &index);
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	map.dirtyCells.clear();
+	map.allDirty = 0;
+}
+
+void TilemapLayer::updateTileColors(gl2d::Texture &tiles, gl2d::TextureAtlasPadding &tilesAtlas)
+{
+	if (tiles.id == tileColorsTexture) { return; }
+	tileColorsTexture = tiles.id;
+
+	glm::ivec2 size = tiles.GetSize();
+	if (size.x <= 0 || size.y <= 0) { return; }
+
+	std::vector<unsigned char> pixels((size_t)size.x * size.y * 4);
+	tiles.bind();
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (int i = 0; i < 10; i++)
+	{
+		glm::vec4 rect = tilesAtlas.get(i, 0);
+		glm::ivec2 min = glm::vec2(std::min(rect.x, rect.z), std::min(rect.y, rect.w)) * glm::vec2(size);
+		glm::ivec2 max = glm::vec2(std::max(rect.x, rect.z), std::max(rect.y, rect.w)) * glm::vec2(size);
+		min = glm::clamp(min, glm::ivec2(0), size);
+		max = glm::clamp(max, min, size);
+
+		//weighted by alpha so transparent pixels don't pull the color to black
+		glm::vec4 sum = {};
+		for (int y = min.y; y < max.y; y++)
+		{
+			for (int x = min.x; x < max.x; x++)
+			{
+				const unsigned char *p = &pixels[((size_t)y * size.x + x) * 4];
+				float a = p[3] / 255.f;
+				sum += glm::vec4(p[0] / 255.f * a, p[1] / 255.f * a, p[2] / 255.f * a, a);
+			}
+		}
+
+		int count = (max.x - min.x) * (max.y - min.y);
+		if (sum.a > 0)
+		{
+			tileColors[i] = glm::vec4(glm::vec3(sum) / sum.a, sum.a / count);
+		}
+		else
+		{
+			tileColors[i] = {};
+		}
+	}
+}
+
+void TilemapLayer::render(gl2d::Renderer2D &renderer, Map &map, gl2d::Texture &tiles,
+	gl2d::TextureAtlasPadding &tilesAtlas, bool simulateFog,
+	const std::vector<int> &viewLevel, const std::vector<glm::ivec2> &playerPos,
+	CullingStats *stats)
+{
+	if (!isReady() || renderer.windowW == 0 || renderer.windowH == 0) { return; }
+
+	update(map);
+
+	glm::vec2 drawSize(100, 100);
+
+	//the quad only covers the tiles on screen
+	glm::ivec4 visible = visibleTiles(renderer, map.size, drawSize.x);
+	glm::ivec2 visibleSize = glm::ivec2(visible.z, visible.w) - glm::ivec2(visible.x, visible.y);
+
+	if (stats)
+	{
+		stats->submitted += visibleSize.x * visibleSize.y;
+		stats->culled += map.size.x * map.size.y - visibleSize.x * visibleSize.y;
+	}
+
+	if (visibleSize.x <= 0 || visibleSize.y <= 0) { return; }
+
+	//keep the draw order, what was queued before the map goes under it
+	renderer.flush();
+
+	glm::vec4 screenRect = renderer.toScreen({drawSize * glm::vec2(visible.x, visible.y),
+		drawSize * glm::vec2(visibleSize)});
+	glm::vec4 mapRect = visible;
+
+	bool minimap = minimapProgram.id && isMinimapZoom(renderer);
+	auto &program = minimap ? minimapProgram : tilesProgram;
+
+	glm::vec4 atlasRects[10];
+	for (int i = 0; i < 10; i++)
+	{
+		atlasRects[i] = tilesAtlas.get(i, 0);
+	}
+
+	if (minimap)
+	{
+		updateTileColors(tiles, tilesAtlas);
+	}
+
+	int playerCount = std::min<int>(std::min(viewLevel.size(), playerPos.size()), MAX_FOG_PLAYERS);
+	glm::vec2 fogPos[MAX_FOG_PLAYERS] = {};
+	float fogRadius[MAX_FOG_PLAYERS] = {};
+	for (int i = 0; i < playerCount; i++)
+	{
+		fogPos[i] = playerPos[i];
+		fogRadius[i] = viewRadius(viewLevel[i]);
+	}
+
+	gl2d::enableNecessaryGLFeatures();
+	glViewport(0, 0, renderer.windowW, renderer.windowH);
+
+	//uniforms a program doesn't have are at -1 and ignored
+	glUseProgram(program.id);
+	glUniform4fv(program.u_screenRect, 1, &screenRect[0]);
+	glUniform4fv(program.u_mapRect, 1, &mapRect[0]);
+	glUniform4fv(program.u_atlasRects, 10, &atlasRects[0][0]);
+	glUniform4fv(program.u_tileColors, 10, &tileColors[0][0]);
+	glUniform1i(program.u_fog, simulateFog);
+	glUniform1i(program.u_playerCount, playerCount);
+	glUniform2fv(program.u_playerPos, MAX_FOG_PLAYERS, &fogPos[0][0]);
+	glUniform1fv(program.u_viewRadius, MAX_FOG_PLAYERS, fogRadius);
+
+	glUniform1i(program.u_sampler, 0);
+	glUniform1i(program.u_tiles, 1);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, tileTexture);
+	glActiveTexture(GL_TEXTURE0);
+	tiles.bind();
+
+	glBindVertexArray(vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -12,6 +12,7 @@
 #include "gameLayer.h"
 #include <fstream>
 #include <chrono>
+#include <algorithm>
 
 #define REMOVE_IMGUI 0
 
@@ -34,6 +35,18 @@
 bool currentFullScreen = 0;
 bool fullScreen = 0;
 
+//while this is positive the loop polls events at full rate,
+//after that it waits for events with idleFrameTime as a timeout
+float fullFrameRateTime = 1;
+bool idleThrottling = 1;
+static const float inputFullFrameRateTime = 1;
+static const double idleFrameTime = 1.0 / 15; //under the 1/10 delta time clamp so timers stay right
+
+void inputActivity()
+{
+	fullFrameRateTime = std::max(fullFrameRateTime, inputFullFrameRateTime);
+}
+
 #pragma endregion
 
 
@@ -41,6 +54,8 @@ bool fullScreen = 0;
 void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
 
+	inputActivity();
+
 	if ((action == GLFW_REPEAT || action == GLFW_PRESS) && key == GLFW_KEY_BACKSPACE)
 	{
 		platform::internal::addToTypedInput(8);
@@ -121,6 +136,8 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
 
 void mouseCallback(GLFWwindow *window, int key, int action, int mods)
 {
+	inputActivity();
+
 	bool state = 0;
 
 	if (action == GLFW_PRESS)
@@ -152,6 +169,8 @@ bool windowFocus = 1;
 
 void windowFocusCallback(GLFWwindow *window, int focused)
 {
+	inputActivity();
+
 	if (focused)
 	{
 		windowFocus = 1;
@@ -167,6 +186,7 @@ void windowFocusCallback(GLFWwindow *window, int focused)
 
 void windowSizeCallback(GLFWwindow *window, int x, int y)
 {
+	inputActivity();
 	platform::internal::resetInputsToZero();
 }
 
@@ -175,10 +195,18 @@ int mouseMovedFlag = 0;
 void cursorPositionCallback(GLFWwindow *window, double xpos, double ypos)
 {
 	mouseMovedFlag = 1;
+	inputActivity();
+}
+
+void scrollCallback(GLFWwindow *window, double xoffset, double yoffset)
+{
+	inputActivity();
 }
 
 void characterCallback(GLFWwindow *window, unsigned int codepoint)
 {
+	inputActivity();
+
 	if (codepoint < 127)
 	{
 		platform::internal::addToTypedInput(codepoint);
@@ -251,6 +279,22 @@ namespace platform
 		return mouseMovedFlag;
 	}
 
+	void requestFullFrameRate(float seconds)
+	{
+		fullFrameRateTime = std::max(fullFrameRateTime, seconds);
+	}
+
+	void setIdleThrottling(bool throttle)
+	{
+		idleThrottling = throttle;
+		fullFrameRateTime = std::max(fullFrameRateTime, inputFullFrameRateTime);
+	}
+
+	bool isIdleThrottling()
+	{
+		return idleThrottling;
+	}
+
 	bool writeEntireFile(const char *name, void *buffer, size_t size)
 	{
 		std::ofstream f(name, std::ios::binary);
@@ -328,6 +372,7 @@ int main()
 	glfwSetWindowSizeCallback(wind, windowSizeCallback);
 	glfwSetCursorPosCallback(wind, cursorPositionCallback);
 	glfwSetCharCallback(wind, characterCallback);
+	glfwSetScrollCallback(wind, scrollCallback);
 
 	//permaAssertComment(gladLoadGL(), "err initializing glad");
 	//permaAssertComment(gladLoadGLLoader((GLADloadproc)glfwGetProcAddress), "err initializing glad");
@@ -505,7 +550,17 @@ int main()
 		#pragma endregion
 
 		glfwSwapBuffers(wind);
-		glfwPollEvents();
+
+		fullFrameRateTime -= deltaTime;
+		if (idleThrottling && fullFrameRateTime <= 0)
+		{
+			//nothing moved for a while, sleep until input or the next idle frame
+			glfwWaitEventsTimeout(idleFrameTime);
+		}
+		else
+		{
+			glfwPollEvents();
+		}
 
 	#pragma endregion
 
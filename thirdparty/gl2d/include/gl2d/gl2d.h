@@ -53,6 +53,8 @@
 #include <stb_image/stb_image.h>
 #include <stb_truetype/stb_truetype.h>
 #include <vector>
+#include <string>
+#include <unordered_map>
 
 namespace gl2d
 {
@@ -312,13 +314,79 @@ namespace gl2d
 	};
 
 
-	enum Renderer2DBufferType
+	//Vertex buffer that is rewritten every flush without waiting for the gpu.
+	//With GL 4.4 (or ARB_buffer_storage) it is a persistently mapped ring of regions
+	//guarded by fences, otherwise it is orphaned when full and filled with glBufferSubData.
+	struct StreamingBuffer
 	{
-		quadPositions,
-		quadColors,
-		texturePositions,
+		GLuint buffer = 0;
 
-		bufferSize
+		void create(size_t regionSize = 1024 * 64);
+		void cleanup();
+
+		//copies the data, binds the buffer to GL_ARRAY_BUFFER
+		//and returns the offset of the data in it
+		size_t upload(const void *data, size_t size);
+
+		//call after the draws that use the data uploaded so far
+		void fence();
+
+		static constexpr int REGIONS = 3;
+
+		bool persistent = 0;
+		size_t regionSize = 0;
+		int region = 0;
+		size_t offset = 0; //in the current region
+		unsigned char *mapped = nullptr;
+		GLsync fences[REGIONS] = {};
+
+	private:
+		void allocate(size_t regionSize);
+	};
+
+	//One sprite as the renderer stores it, 56 bytes. With the default shader the 4 corners are
+	//made in the vertex shader from this, custom shaders get the old 6 vertices per sprite.
+	//The position stays float, world pixels need it, the texture coordinates are 16 bit
+	//normalized so they are clamped to [0, 1].
+	struct QuadInstance
+	{
+		glm::vec4 rect = {};                   //x y w h in pixels
+		unsigned short textureCoords[4] = {};  //unorm16
+		glm::vec2 origin = {};                 //rotation origin in pixels
+		float rotation = 0;                    //degrees
+		unsigned int colors[4] = {};           //rgba8: top left, bottom left, bottom right, top right
+		unsigned int cameraAndSlot = 0;        //index in Renderer2D::batchCameras in the low 24 bits,
+		                                       //texture unit of the sprite (set at flush) in the high 8
+
+		void setTextureCoords(glm::vec4 t)
+		{
+			t = glm::clamp(t, 0.f, 1.f) * 65535.f + 0.5f;
+			for (int i = 0; i < 4; i++) { textureCoords[i] = (unsigned short)t[i]; }
+		}
+
+		glm::vec4 getTextureCoords() const
+		{
+			return glm::vec4(textureCoords[0], textureCoords[1], textureCoords[2], textureCoords[3]) / 65535.f;
+		}
+
+		int getCamera() const { return cameraAndSlot & 0xFFFFFF; }
+		void setCamera(int camera) { cameraAndSlot = (cameraAndSlot & 0xFF000000u) | ((unsigned int)camera & 0xFFFFFF); }
+		void setTextureSlot(int slot) { cameraAndSlot = (cameraAndSlot & 0xFFFFFF) | ((unsigned int)slot << 24); }
+	};
+
+	//The glyph quads of a string laid out at the origin,
+	//renderText only offsets and copies them.
+	struct TextLayout
+	{
+		struct Glyph
+		{
+			glm::vec4 rect = {};
+			glm::vec4 textureCoords = {};
+		};
+
+		std::vector<Glyph> glyphs;
+		glm::vec2 size = {};         //what getTextSize returns
+		glm::vec2 centerOffset = {}; //subtracted from the position when showInCenter is set
 	};
 
 	typedef struct Renderer2D Renderer2D;
@@ -345,14 +413,26 @@ namespace gl2d
 
 		GLuint defaultFBO = 0;
 
-		GLuint buffers[Renderer2DBufferType::bufferSize] = {};
 		GLuint vao = {};
+		GLuint instanceVao = 0;
+
+		//all the vertex data of a flush goes here
+		StreamingBuffer streamingBuffer;
+
+		//draw calls issued by the last flush, for profiling
+		int drawCalls = 0;
 
-		//4 elements each component
+		//one per sprite
+		std::vector<QuadInstance>quadInstances;
+		std::vector<Texture>spriteTextures;
+
+		//cameras used by the sprites so far, a new one is added each time the camera changes
+		std::vector<Camera>batchCameras;
+
+		//6 elements each component, only filled in flush for custom shaders
 		std::vector<glm::vec2>spritePositions;
 		std::vector<glm::vec4>spriteColors;
 		std::vector<glm::vec2>texturePositions;
-		std::vector<Texture>spriteTextures;
 		
 		//glm::vec2 spritePositions[GL2D_Renderer2D_Max_Triangle_Capacity * 6];
 		//glm::vec4 spriteColors[GL2D_Renderer2D_Max_Triangle_Capacity * 6];
@@ -388,6 +468,8 @@ namespace gl2d
 		//clears the things that are to be drawn when calling flush
 		inline void clearDrawData()
 		{
+			quadInstances.clear();
+			batchCameras.clear();
 			spritePositions.clear();
 			spriteColors.clear();
 			texturePositions.clear();
@@ -402,6 +484,15 @@ namespace gl2d
 		glm::vec2 getTextSize(const char *text, const Font font, const float size = 1.5f,
 			const float spacing = 4, const float line_space = 3);
 
+		//Layouts are cached by string, font, size and spacing. The reference is
+		//valid until the next call, the cache is dropped when it grows too big.
+		const TextLayout &getTextLayout(const char *text, const Font font, const float size = 1.5f,
+			const float spacing = 4, const float line_space = 3);
+
+		std::unordered_map<std::string, TextLayout> textLayoutCache;
+		std::string textLayoutKey;
+		static constexpr size_t MAX_CACHED_TEXT_LAYOUTS = 1024;
+
 		// The origin will be the bottom left corner since it represents the line for the text to be drawn
 		//Pacing and lineSpace are influenced by size
 		//todo the function should returns the size of the text drawn also refactor
@@ -45,6 +45,14 @@
 // removed capacity render limit
 // added some more comments
 // 
+// 1.4.1
+// instanced quads for the default shader, the
+//  camera is applied in the vertex shader
+// streaming vertex buffers that don't stall
+// up to 8 textures per draw call in the
+//  instanced path
+// cached text layouts
+// 
 /////////////////////////////////////////////////////////
 
 
@@ -67,6 +75,9 @@
 #include <sstream>
 #include <algorithm>
 #include <iostream>
+#include <cstddef>
+#include <cstring>
+#include <limits>
 
 //if you are not using visual studio make shure you link to "Opengl32.lib"
 #ifdef _MSC_VER
@@ -83,6 +94,12 @@ namespace gl2d
 #pragma region shaders
 
 	static ShaderProgram defaultShader = {};
+	static ShaderProgram instancedShader = {};
+	static GLint instancedWindowSizeUniform = -1;
+	static GLint instancedCamerasUniform = -1;
+	static GLint instancedCameraBaseUniform = -1;
+	static const int instancedCameraCount = 64;
+	static const int instancedTextureSlots = 8;
 	static Camera defaultCamera{};
 	static Texture white1pxSquareTexture = {};
 
@@ -101,6 +118,74 @@ namespace gl2d
 		"	v_texture = texturePositions;\n"
 		"}\n";
 
+	//corners come from gl_VertexID (triangle strip), the rest from the instance
+	static const char* instancedVertexShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		"layout(location = 0) in vec4 i_rect;\n"
+		"layout(location = 1) in vec4 i_textureCoords;\n"
+		"layout(location = 2) in vec3 i_transform;\n" //origin, rotation
+		"layout(location = 3) in vec4 i_color0;\n"
+		"layout(location = 4) in vec4 i_color1;\n"
+		"layout(location = 5) in vec4 i_color2;\n"
+		"layout(location = 6) in vec4 i_color3;\n"
+		"layout(location = 7) in uint i_cameraAndSlot;\n"
+		"uniform vec2 u_windowSize;\n"
+		"uniform vec4 u_cameras[64];\n" //position, rotation, zoom
+		"uniform float u_cameraBase;\n"
+		"out vec4 v_color;\n"
+		"out vec2 v_texture;\n"
+		"flat out int v_textureSlot;\n"
+		"vec2 rotateAroundPoint(vec2 v, vec2 p, float degrees)\n"
+		"{\n"
+		"	float a = radians(degrees);\n"
+		"	float s = sin(a);\n"
+		"	float c = cos(a);\n"
+		"	v -= p;\n"
+		"	return vec2(v.x * c - v.y * s, v.x * s + v.y * c) + p;\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);\n"
+		"	vec2 p = vec2(i_rect.x + corner.x * i_rect.z, -i_rect.y - corner.y * i_rect.w);\n"
+		"	if (i_transform.z != 0) { p = rotateAroundPoint(p, vec2(i_transform.x, -i_transform.y), i_transform.z); }\n"
+		"	vec4 camera = u_cameras[int(float(i_cameraAndSlot & 0xFFFFFFu) - u_cameraBase)];\n"
+		"	p += vec2(-camera.x, camera.y);\n"
+		"	vec2 center = vec2(u_windowSize.x, -u_windowSize.y) * 0.5;\n"
+		"	if (camera.z != 0) { p = rotateAroundPoint(p, center, camera.z); }\n"
+		"	p = (p - center) * camera.w + center;\n"
+		"	gl_Position = vec4(p.x / u_windowSize.x * 2 - 1, p.y / u_windowSize.y * 2 + 1, 0, 1);\n"
+		"	v_texture = vec2(mix(i_textureCoords.x, i_textureCoords.z, corner.x), mix(i_textureCoords.y, i_textureCoords.w, corner.y));\n"
+		"	v_color = corner.x == 0 ? (corner.y == 0 ? i_color0 : i_color1) : (corner.y == 0 ? i_color3 : i_color2);\n"
+		"	v_textureSlot = int(i_cameraAndSlot >> 24);\n"
+		"}\n";
+
+	//glsl 330 can't index samplers with a variable, hence the if chain.
+	//The gradients are taken outside of it since the branch isn't uniform
+	static const char* instancedFragmentShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		"in vec4 v_color;\n"
+		"in vec2 v_texture;\n"
+		"flat in int v_textureSlot;\n"
+		"out vec4 color;\n"
+		"uniform sampler2D u_samplers[8];\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 dx = dFdx(v_texture);\n"
+		"	vec2 dy = dFdy(v_texture);\n"
+		"	vec4 t;\n"
+		"	if (v_textureSlot == 0) { t = textureGrad(u_samplers[0], v_texture, dx, dy); }\n"
+		"	else if (v_textureSlot == 1) { t = textureGrad(u_samplers[1], v_texture, dx, dy); }\n"
+		"	else if (v_textureSlot == 2) { t = textureGrad(u_samplers[2], v_texture, dx, dy); }\n"
+		"	else if (v_textureSlot == 3) { t = textureGrad(u_samplers[3], v_texture, dx, dy); }\n"
+		"	else if (v_textureSlot == 4) { t = textureGrad(u_samplers[4], v_texture, dx, dy); }\n"
+		"	else if (v_textureSlot == 5) { t = textureGrad(u_samplers[5], v_texture, dx, dy); }\n"
+		"	else if (v_textureSlot == 6) { t = textureGrad(u_samplers[6], v_texture, dx, dy); }\n"
+		"	else { t = textureGrad(u_samplers[7], v_texture, dx, dy); }\n"
+		"	color = v_color * t;\n"
+		"}\n";
+
 	static const char* defaultFragmentShader =
 		GL2D_OPNEGL_SHADER_VERSION "\n"
 		GL2D_OPNEGL_SHADER_PRECISION "\n"
@@ -242,6 +327,17 @@ namespace gl2d
 	#endif
 
 		defaultShader = createShaderProgram(defaultVertexShader, defaultFragmentShader);
+		instancedShader = createShaderProgram(instancedVertexShader, instancedFragmentShader);
+		instancedWindowSizeUniform = glGetUniformLocation(instancedShader.id, "u_windowSize");
+		instancedCamerasUniform = glGetUniformLocation(instancedShader.id, "u_cameras");
+		instancedCameraBaseUniform = glGetUniformLocation(instancedShader.id, "u_cameraBase");
+		{
+			int slots[instancedTextureSlots] = {};
+			for (int i = 0; i < instancedTextureSlots; i++) { slots[i] = i; }
+			glUseProgram(instancedShader.id);
+			glUniform1iv(glGetUniformLocation(instancedShader.id, "u_samplers"), instancedTextureSlots, slots);
+			glUseProgram(0);
+		}
 		white1pxSquareTexture.create1PxSquare();
 
 		enableNecessaryGLFeatures();
@@ -251,6 +347,7 @@ namespace gl2d
 	{
 		white1pxSquareTexture.cleanup();
 		glDeleteShader(defaultShader.id);
+		glDeleteProgram(instancedShader.id);
 		hasInitialized = false;
 	}
 
@@ -477,42 +574,391 @@ namespace gl2d
 	///////////////////// Camera /////////////////////
 #pragma region Camera
 
+#pragma endregion
+
+	///////////////////// StreamingBuffer /////////////////////
+#pragma region StreamingBuffer
+
+	static bool hasBufferStorage()
+	{
+		return (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) && glBufferStorage != nullptr;
+	}
+
+	void StreamingBuffer::create(size_t regionSize)
+	{
+		cleanup();
+		persistent = hasBufferStorage();
+		allocate(std::max<size_t>(regionSize, 1024));
+	}
+
+	void StreamingBuffer::allocate(size_t regionSize)
+	{
+		//the old storage is freed by the driver once the gpu is done with it
+		if (buffer)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			if (mapped) { glUnmapBuffer(GL_ARRAY_BUFFER); }
+			glDeleteBuffers(1, &buffer);
+		}
+
+		for (auto &f : fences)
+		{
+			if (f) { glDeleteSync(f); }
+			f = 0;
+		}
+
+		this->regionSize = regionSize;
+		region = 0;
+		offset = 0;
+		mapped = nullptr;
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+		if (persistent)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, regionSize * REGIONS, nullptr, flags);
+			mapped = (unsigned char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * REGIONS, flags);
+
+			if (!mapped)
+			{
+				//some drivers advertise it but won't map, use the 3.3 path
+				persistent = 0;
+				glDeleteBuffers(1, &buffer);
+				glGenBuffers(1, &buffer);
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			}
+		}
+
+		if (!persistent)
+		{
+			glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+		}
+	}
+
+	void StreamingBuffer::cleanup()
+	{
+		if (buffer)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			if (mapped) { glUnmapBuffer(GL_ARRAY_BUFFER); }
+			glDeleteBuffers(1, &buffer);
+		}
+
+		for (auto &f : fences)
+		{
+			if (f) { glDeleteSync(f); }
+			f = 0;
+		}
+
+		buffer = 0;
+		mapped = nullptr;
+		regionSize = 0;
+		region = 0;
+		offset = 0;
+	}
+
+	size_t StreamingBuffer::upload(const void *data, size_t size)
+	{
+		//keeps the attribute offsets aligned
+		size_t alignedSize = (size + 63) & ~(size_t)63;
+
+		if (alignedSize > regionSize)
+		{
+			allocate(std::max(alignedSize, regionSize * 2));
+		}
+
+		if (!persistent)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+			if (offset + alignedSize > regionSize)
+			{
+				//orphan: the gpu keeps reading the old storage, we get a fresh one
+				glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+				offset = 0;
+			}
+
+			glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+			size_t ret = offset;
+			offset += alignedSize;
+			return ret;
+		}
+
+		if (offset + alignedSize > regionSize)
+		{
+			fence();
+			region = (region + 1) % REGIONS;
+			offset = 0;
+
+			if (fences[region])
+			{
+				GLenum status = glClientWaitSync(fences[region], 0, 0);
+				glDeleteSync(fences[region]);
+				fences[region] = 0;
+
+				if (status == GL_TIMEOUT_EXPIRED)
+				{
+					//the gpu is still reading this region, take new storage instead of waiting
+					allocate(regionSize);
+				}
+			}
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		size_t ret = region * regionSize + offset;
+		memcpy(mapped + ret, data, size);
+		offset += alignedSize;
+		return ret;
+	}
+
+	void StreamingBuffer::fence()
+	{
+		if (!persistent) { return; }
+
+		if (fences[region]) { glDeleteSync(fences[region]); }
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
 #pragma endregion
 
 	///////////////////// Renderer2D /////////////////////
 #pragma region Renderer2D
 
-	//won't bind any fbo
-	void internalFlush(gl2d::Renderer2D &renderer, bool clearDrawData)
+	//the old per vertex path, custom shaders still expect these attributes
+	static void expandQuad(gl2d::Renderer2D &renderer, const QuadInstance &q, const Camera &camera)
 	{
-		enableNecessaryGLFeatures();
+		//We need to flip texture_transforms.y
+		const float transformsY = q.rect.y * -1;
 
-		if (!hasInitialized)
+		glm::vec2 v1 = { q.rect.x,				  transformsY };
+		glm::vec2 v2 = { q.rect.x,				  transformsY - q.rect.w };
+		glm::vec2 v3 = { q.rect.x + q.rect.z, transformsY - q.rect.w };
+		glm::vec2 v4 = { q.rect.x + q.rect.z, transformsY };
+
+		//Apply rotations
+		if (q.rotation != 0)
 		{
-			errorFunc("Library not initialized. Have you forgotten to call gl2d::init() ?", userDefinedData);
+			v1 = rotateAroundPoint(v1, q.origin, q.rotation);
+			v2 = rotateAroundPoint(v2, q.origin, q.rotation);
+			v3 = rotateAroundPoint(v3, q.origin, q.rotation);
+			v4 = rotateAroundPoint(v4, q.origin, q.rotation);
 		}
 
-		if (!renderer.vao)
+		//Apply camera transformations
+		v1.x -= camera.position.x;
+		v1.y += camera.position.y;
+		v2.x -= camera.position.x;
+		v2.y += camera.position.y;
+		v3.x -= camera.position.x;
+		v3.y += camera.position.y;
+		v4.x -= camera.position.x;
+		v4.y += camera.position.y;
+
+		const float windowW = renderer.windowW;
+		const float windowH = renderer.windowH;
+
+		//Apply camera rotation
+		if (camera.rotation != 0)
 		{
-			errorFunc("Renderer not initialized. Have you forgotten to call gl2d::Renderer2D::create() ?", userDefinedData);
+			glm::vec2 cameraCenter;
+
+			cameraCenter.x = windowW / 2.0f;
+			cameraCenter.y = windowH / 2.0f;
+
+			v1 = rotateAroundPoint(v1, cameraCenter, camera.rotation);
+			v2 = rotateAroundPoint(v2, cameraCenter, camera.rotation);
+			v3 = rotateAroundPoint(v3, cameraCenter, camera.rotation);
+			v4 = rotateAroundPoint(v4, cameraCenter, camera.rotation);
 		}
 
-		if (renderer.windowH == 0 || renderer.windowW == 0)
+		//Apply camera zoom
 		{
-			if (clearDrawData)
+			glm::vec2 cameraCenter;
+			cameraCenter.x = windowW / 2.0f;
+			cameraCenter.y = -windowH / 2.0f;
+
+			v1 = scaleAroundPoint(v1, cameraCenter, camera.zoom);
+			v2 = scaleAroundPoint(v2, cameraCenter, camera.zoom);
+			v3 = scaleAroundPoint(v3, cameraCenter, camera.zoom);
+			v4 = scaleAroundPoint(v4, cameraCenter, camera.zoom);
+		}
+
+		v1.x = internal::positionToScreenCoordsX(v1.x, windowW);
+		v2.x = internal::positionToScreenCoordsX(v2.x, windowW);
+		v3.x = internal::positionToScreenCoordsX(v3.x, windowW);
+		v4.x = internal::positionToScreenCoordsX(v4.x, windowW);
+		v1.y = internal::positionToScreenCoordsY(v1.y, windowH);
+		v2.y = internal::positionToScreenCoordsY(v2.y, windowH);
+		v3.y = internal::positionToScreenCoordsY(v3.y, windowH);
+		v4.y = internal::positionToScreenCoordsY(v4.y, windowH);
+
+		renderer.spritePositions.push_back(glm::vec2{ v1.x, v1.y });
+		renderer.spritePositions.push_back(glm::vec2{ v2.x, v2.y });
+		renderer.spritePositions.push_back(glm::vec2{ v4.x, v4.y });
+
+		renderer.spritePositions.push_back(glm::vec2{ v2.x, v2.y });
+		renderer.spritePositions.push_back(glm::vec2{ v3.x, v3.y });
+		renderer.spritePositions.push_back(glm::vec2{ v4.x, v4.y });
+
+		glm::vec4 colors[4];
+		for (int i = 0; i < 4; i++)
+		{
+			colors[i] = glm::vec4(
+				(q.colors[i] & 0xFF) / 255.f,
+				((q.colors[i] >> 8) & 0xFF) / 255.f,
+				((q.colors[i] >> 16) & 0xFF) / 255.f,
+				((q.colors[i] >> 24) & 0xFF) / 255.f);
+		}
+
+		renderer.spriteColors.push_back(colors[0]);
+		renderer.spriteColors.push_back(colors[1]);
+		renderer.spriteColors.push_back(colors[3]);
+		renderer.spriteColors.push_back(colors[1]);
+		renderer.spriteColors.push_back(colors[2]);
+		renderer.spriteColors.push_back(colors[3]);
+
+		const glm::vec4 textureCoords = q.getTextureCoords();
+		renderer.texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.y }); //1
+		renderer.texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
+		renderer.texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
+		renderer.texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
+		renderer.texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.w }); //3
+		renderer.texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
+	}
+
+	static void bindInstanceAttributes(size_t bufferOffset, size_t firstInstance)
+	{
+		const char *base = (const char *)(bufferOffset + firstInstance * sizeof(QuadInstance));
+
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), base + offsetof(QuadInstance, rect));
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuadInstance), base + offsetof(QuadInstance, textureCoords));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), base + offsetof(QuadInstance, origin));
+		glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(QuadInstance), base + offsetof(QuadInstance, cameraAndSlot));
+
+		for (int i = 0; i < 4; i++)
+		{
+			glVertexAttribPointer(3 + i, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuadInstance),
+				base + offsetof(QuadInstance, colors) + i * sizeof(unsigned int));
+		}
+	}
+
+	static void uploadCameras(gl2d::Renderer2D &renderer, int first)
+	{
+		glm::vec4 cameras[instancedCameraCount] = {};
+		int count = std::min<int>(instancedCameraCount, renderer.batchCameras.size() - first);
+
+		for (int i = 0; i < count; i++)
+		{
+			auto &c = renderer.batchCameras[first + i];
+			cameras[i] = {c.position.x, c.position.y, c.rotation, c.zoom};
+		}
+
+		glUniform4fv(instancedCamerasUniform, instancedCameraCount, &cameras[0][0]);
+		glUniform1f(instancedCameraBaseUniform, (float)first);
+	}
+
+	//a run of instances drawn with one call
+	struct InstanceBatch
+	{
+		int begin = 0;
+		int end = 0;
+		int cameraChunk = 0;
+		int textureCount = 0;
+		GLuint textures[instancedTextureSlots] = {};
+	};
+
+	static std::vector<InstanceBatch> instanceBatches;
+
+	//One instance per sprite. Every distinct texture of a batch gets a texture unit,
+	//a new batch starts only when the units run out or after instancedCameraCount cameras.
+	static void instancedFlush(gl2d::Renderer2D &renderer)
+	{
+		const int size = renderer.quadInstances.size();
+
+		instanceBatches.clear();
+		instanceBatches.push_back({});
+		instanceBatches.back().cameraChunk = renderer.quadInstances[0].getCamera() / instancedCameraCount;
+
+		for (int i = 0; i < size; i++)
+		{
+			auto &q = renderer.quadInstances[i];
+			GLuint id = renderer.spriteTextures[i].id;
+			int chunk = q.getCamera() / instancedCameraCount;
+
+			auto *batch = &instanceBatches.back();
+
+			int slot = 0;
+			for (; slot < batch->textureCount; slot++)
 			{
-				renderer.clearDrawData();
+				if (batch->textures[slot] == id) { break; }
 			}
 
-			return;
+			if (chunk != batch->cameraChunk || slot == instancedTextureSlots)
+			{
+				batch->end = i;
+				instanceBatches.push_back({});
+				batch = &instanceBatches.back();
+				batch->begin = i;
+				batch->cameraChunk = chunk;
+				slot = 0;
+			}
+
+			if (slot == batch->textureCount)
+			{
+				batch->textures[batch->textureCount++] = id;
+			}
+
+			q.setTextureSlot(slot);
 		}
+		instanceBatches.back().end = size;
 
-		if(renderer.spriteTextures.empty())
+		glBindVertexArray(renderer.instanceVao);
+
+		glUseProgram(instancedShader.id);
+		glUniform2f(instancedWindowSizeUniform, (float)renderer.windowW, (float)renderer.windowH);
+
+		size_t bufferOffset = renderer.streamingBuffer.upload(renderer.quadInstances.data(),
+			size * sizeof(QuadInstance));
+
+		int cameraChunk = -1;
+		for (auto &batch : instanceBatches)
 		{
-			return;
+			for (int t = 0; t < batch.textureCount; t++)
+			{
+				glActiveTexture(GL_TEXTURE0 + t);
+				glBindTexture(GL_TEXTURE_2D, batch.textures[t]);
+			}
+
+			if (batch.cameraChunk != cameraChunk)
+			{
+				cameraChunk = batch.cameraChunk;
+				uploadCameras(renderer, cameraChunk * instancedCameraCount);
+			}
+
+			bindInstanceAttributes(bufferOffset, batch.begin);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batch.end - batch.begin);
+			renderer.drawCalls++;
 		}
 
-		glViewport(0, 0, renderer.windowW, renderer.windowH);
+		glActiveTexture(GL_TEXTURE0);
+		glBindVertexArray(0);
+
+		renderer.streamingBuffer.fence();
+	}
+
+	//builds the 6 vertices per sprite on the cpu, for custom shaders
+	static void legacyFlush(gl2d::Renderer2D &renderer)
+	{
+		renderer.spritePositions.clear();
+		renderer.spriteColors.clear();
+		renderer.texturePositions.clear();
+
+		for (auto &q : renderer.quadInstances)
+		{
+			expandQuad(renderer, q, renderer.batchCameras[q.getCamera()]);
+		}
 
 		glBindVertexArray(renderer.vao);
 
@@ -520,14 +966,23 @@ namespace gl2d
 
 		glUniform1i(renderer.currentShader.u_sampler, 0);
 
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::quadPositions]);
-		glBufferData(GL_ARRAY_BUFFER, renderer.spritePositions.size() * sizeof(glm::vec2), renderer.spritePositions.data(), GL_STREAM_DRAW);
+		auto &stream = renderer.streamingBuffer;
+
+		//one upload, a second one could land in new storage and lose the first
+		size_t positionsSize = renderer.spritePositions.size() * sizeof(glm::vec2);
+		size_t colorsSize = renderer.spriteColors.size() * sizeof(glm::vec4);
+		size_t texturesSize = renderer.texturePositions.size() * sizeof(glm::vec2);
 
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::quadColors]);
-		glBufferData(GL_ARRAY_BUFFER, renderer.spriteColors.size() * sizeof(glm::vec4), renderer.spriteColors.data(), GL_STREAM_DRAW);
+		static std::vector<unsigned char> staging;
+		staging.resize(positionsSize + colorsSize + texturesSize);
+		memcpy(staging.data(), renderer.spritePositions.data(), positionsSize);
+		memcpy(staging.data() + positionsSize, renderer.spriteColors.data(), colorsSize);
+		memcpy(staging.data() + positionsSize + colorsSize, renderer.texturePositions.data(), texturesSize);
 
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::texturePositions]);
-		glBufferData(GL_ARRAY_BUFFER, renderer.texturePositions.size() * sizeof(glm::vec2), renderer.texturePositions.data(), GL_STREAM_DRAW);
+		size_t offset = stream.upload(staging.data(), staging.size());
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void *)offset);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void *)(offset + positionsSize));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *)(offset + positionsSize + colorsSize));
 
 		//Instance render the textures
 		{
@@ -542,6 +997,7 @@ namespace gl2d
 				if (renderer.spriteTextures[i].id != id)
 				{
 					glDrawArrays(GL_TRIANGLES, pos * 6, 6 * (i - pos));
+					renderer.drawCalls++;
 
 					pos = i;
 					id = renderer.spriteTextures[i].id;
@@ -552,10 +1008,57 @@ namespace gl2d
 			}
 
 			glDrawArrays(GL_TRIANGLES, pos * 6, 6 * (size - pos));
+			renderer.drawCalls++;
 
 			glBindVertexArray(0);
 		}
 
+		stream.fence();
+	}
+
+	//won't bind any fbo
+	void internalFlush(gl2d::Renderer2D &renderer, bool clearDrawData)
+	{
+		enableNecessaryGLFeatures();
+
+		if (!hasInitialized)
+		{
+			errorFunc("Library not initialized. Have you forgotten to call gl2d::init() ?", userDefinedData);
+		}
+
+		if (!renderer.vao)
+		{
+			errorFunc("Renderer not initialized. Have you forgotten to call gl2d::Renderer2D::create() ?", userDefinedData);
+		}
+
+		if (renderer.windowH == 0 || renderer.windowW == 0)
+		{
+			if (clearDrawData)
+			{
+				renderer.clearDrawData();
+			}
+
+			return;
+		}
+
+		if(renderer.spriteTextures.empty())
+		{
+			return;
+		}
+
+		glViewport(0, 0, renderer.windowW, renderer.windowH);
+
+		renderer.drawCalls = 0;
+
+		if (renderer.currentShader.id == defaultShader.id && instancedShader.id)
+		{
+			instancedFlush(renderer);
+		}
+		else
+		{
+			legacyFlush(renderer);
+		}
+
 		if (clearDrawData) 
 		{
 			renderer.clearDrawData();
@@ -601,6 +1104,12 @@ namespace gl2d
 		renderRectangleAbsRotation(transforms, texture, colors, newOrigin, rotation, textureCoords);
 	}
 
+	static unsigned int packColor(const Color4f &c)
+	{
+		glm::vec4 b = glm::clamp(c, 0.f, 1.f) * 255.f + 0.5f;
+		return (unsigned int)b.x | ((unsigned int)b.y << 8) | ((unsigned int)b.z << 16) | ((unsigned int)b.w << 24);
+	}
+
 	void gl2d::Renderer2D::renderRectangleAbsRotation(const Rect transforms, 
 		const Texture texture, const Color4f colors[4], const glm::vec2 origin, const float rotation, const glm::vec4 textureCoords)
 	{
@@ -612,92 +1121,27 @@ namespace gl2d
 			textureCopy = white1pxSquareTexture;
 		}
 
-		//We need to flip texture_transforms.y
-		const float transformsY = transforms.y * -1;
-
-		glm::vec2 v1 = { transforms.x,				  transformsY };
-		glm::vec2 v2 = { transforms.x,				  transformsY - transforms.w };
-		glm::vec2 v3 = { transforms.x + transforms.z, transformsY - transforms.w };
-		glm::vec2 v4 = { transforms.x + transforms.z, transformsY };
-
-		//Apply rotations
-		if (rotation != 0)
-		{
-			v1 = rotateAroundPoint(v1, origin, rotation);
-			v2 = rotateAroundPoint(v2, origin, rotation);
-			v3 = rotateAroundPoint(v3, origin, rotation);
-			v4 = rotateAroundPoint(v4, origin, rotation);
-		}
-
-		//Apply camera transformations
-		v1.x -= currentCamera.position.x;
-		v1.y += currentCamera.position.y;
-		v2.x -= currentCamera.position.x;
-		v2.y += currentCamera.position.y;
-		v3.x -= currentCamera.position.x;
-		v3.y += currentCamera.position.y;
-		v4.x -= currentCamera.position.x;
-		v4.y += currentCamera.position.y;
-
-		//Apply camera rotation
-		if (currentCamera.rotation != 0)
+		//the camera is applied at flush, remember the one active now
+		if (batchCameras.empty()
+			|| batchCameras.back().position != currentCamera.position
+			|| batchCameras.back().rotation != currentCamera.rotation
+			|| batchCameras.back().zoom != currentCamera.zoom)
 		{
-			glm::vec2 cameraCenter;
-
-			cameraCenter.x = windowW / 2.0f;
-			cameraCenter.y = windowH / 2.0f;
-
-			v1 = rotateAroundPoint(v1, cameraCenter, currentCamera.rotation);
-			v2 = rotateAroundPoint(v2, cameraCenter, currentCamera.rotation);
-			v3 = rotateAroundPoint(v3, cameraCenter, currentCamera.rotation);
-			v4 = rotateAroundPoint(v4, cameraCenter, currentCamera.rotation);
+			batchCameras.push_back(currentCamera);
 		}
 
-		//Apply camera zoom
-		//if(renderer->currentCamera.zoom != 1)
+		QuadInstance q;
+		q.rect = transforms;
+		q.setTextureCoords(textureCoords);
+		q.origin = origin;
+		q.rotation = rotation;
+		q.setCamera(batchCameras.size() - 1);
+		for (int i = 0; i < 4; i++)
 		{
-
-			glm::vec2 cameraCenter;
-			cameraCenter.x = windowW / 2.0f;
-			cameraCenter.y = -windowH / 2.0f;
-
-			v1 = scaleAroundPoint(v1, cameraCenter, currentCamera.zoom);
-			v2 = scaleAroundPoint(v2, cameraCenter, currentCamera.zoom);
-			v3 = scaleAroundPoint(v3, cameraCenter, currentCamera.zoom);
-			v4 = scaleAroundPoint(v4, cameraCenter, currentCamera.zoom);
+			q.colors[i] = packColor(colors[i]);
 		}
 
-		v1.x = internal::positionToScreenCoordsX(v1.x, (float)windowW);
-		v2.x = internal::positionToScreenCoordsX(v2.x, (float)windowW);
-		v3.x = internal::positionToScreenCoordsX(v3.x, (float)windowW);
-		v4.x = internal::positionToScreenCoordsX(v4.x, (float)windowW);
-		v1.y = internal::positionToScreenCoordsY(v1.y, (float)windowH);
-		v2.y = internal::positionToScreenCoordsY(v2.y, (float)windowH);
-		v3.y = internal::positionToScreenCoordsY(v3.y, (float)windowH);
-		v4.y = internal::positionToScreenCoordsY(v4.y, (float)windowH);
-
-		spritePositions.push_back(glm::vec2{ v1.x, v1.y });
-		spritePositions.push_back(glm::vec2{ v2.x, v2.y });
-		spritePositions.push_back(glm::vec2{ v4.x, v4.y });
-
-		spritePositions.push_back(glm::vec2{ v2.x, v2.y });
-		spritePositions.push_back(glm::vec2{ v3.x, v3.y });
-		spritePositions.push_back(glm::vec2{ v4.x, v4.y });
-
-		spriteColors.push_back(colors[0]);
-		spriteColors.push_back(colors[1]);
-		spriteColors.push_back(colors[3]);
-		spriteColors.push_back(colors[1]);
-		spriteColors.push_back(colors[2]);
-		spriteColors.push_back(colors[3]);
-
-		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.y }); //1
-		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
-		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
-		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
-		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.w }); //3
-		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
-
+		quadInstances.push_back(q);
 		spriteTextures.push_back(textureCopy);
 	}
 
@@ -1012,29 +1456,28 @@ namespace gl2d
 		defaultFBO = fbo;
 
 		clearDrawData();
-		spritePositions.reserve(quadCount * 6);
-		spriteColors.reserve(quadCount * 6);
-		texturePositions.reserve(quadCount * 6);
+		quadInstances.reserve(quadCount);
 		spriteTextures.reserve(quadCount);
 
 		this->resetCameraAndShader();
 
+		streamingBuffer.create(quadCount * sizeof(QuadInstance));
+
+		//the pointers are set at flush, the data lands at a different offset each time
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
+		for (int i = 0; i < 3; i++)
+		{
+			glEnableVertexAttribArray(i);
+		}
 
-		glGenBuffers(Renderer2DBufferType::bufferSize, buffers);
-
-		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::quadPositions]);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::quadColors]);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::texturePositions]);
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		glGenVertexArrays(1, &instanceVao);
+		glBindVertexArray(instanceVao);
+		for (int i = 0; i < 8; i++)
+		{
+			glEnableVertexAttribArray(i);
+			glVertexAttribDivisor(i, 1);
+		}
 
 		glBindVertexArray(0);
 	}
@@ -1042,7 +1485,8 @@ namespace gl2d
 	void Renderer2D::cleanup()
 	{
 		glDeleteVertexArrays(1, &vao);
-		glDeleteBuffers(Renderer2DBufferType::bufferSize, buffers);
+		glDeleteVertexArrays(1, &instanceVao);
+		streamingBuffer.cleanup();
 	}
 
 	void Renderer2D::pushShader(ShaderProgram s)
@@ -1149,32 +1593,27 @@ namespace gl2d
 		return glm::vec4(v1.x, v1.y, v3.x, v3.y);
 	}
 
-	glm::vec2 Renderer2D::getTextSize(const char *text, const Font font,
+	//one pass that gives the glyphs and the sizes the old getTextSize and the
+	//showInCenter pass of renderText computed
+	static void layoutText(TextLayout &layout, const char *text, const Font &font,
 		const float size, const float spacing, const float line_space)
 	{
-		if (font.texture.id == 0)
-		{
-			errorFunc("Missing font", userDefinedData);
-			return {};
-		}
-
-		glm::vec2 position = {};
+		layout.glyphs.clear();
 
 		const int text_length = (int)strlen(text);
 		Rect rectangle = {};
-		rectangle.x = position.x;
-		float linePositionY = position.y;
+		float linePositionY = 0;
 
-		//This is the y position we render at because it advances when we encounter newlines
 		float maxPos = 0;
-		float maxPosY = 0;
+		float maxPosY = 0; //of the last line, for the size
+		float centerMaxPosY = std::numeric_limits<float>::lowest(); //of all the lines, not clamped to 0
 		float bonusY = 0;
 
 		for (int i = 0; i < text_length; i++)
 		{
 			if (text[i] == '\n')
 			{
-				rectangle.x = position.x;
+				rectangle.x = 0;
 				linePositionY += (font.max_height + line_space) * size;
 				bonusY += (font.max_height + line_space) * size;
 				maxPosY = 0;
@@ -1208,24 +1647,61 @@ namespace gl2d
 
 				rectangle.y = linePositionY + quad.y0 * size;
 
+				layout.glyphs.push_back({rectangle, glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1}});
+
 				rectangle.x += rectangle.z + spacing * size;
 
 				maxPosY = std::max(maxPosY, rectangle.y);
+				centerMaxPosY = std::max(centerMaxPosY, rectangle.y);
 				maxPos = std::max(maxPos, rectangle.x);
 			}
 		}
 
+		layout.centerOffset = {maxPos / 2, layout.glyphs.empty() ? 0.f : centerMaxPosY};
+
 		maxPos = std::max(maxPos, rectangle.x);
 		maxPosY = std::max(maxPosY, rectangle.y);
 
-		float paddX = maxPos;
+		layout.size = {maxPos, maxPosY + font.max_height * size + bonusY};
+	}
+
+	const TextLayout &Renderer2D::getTextLayout(const char *text, const Font font,
+		const float size, const float spacing, const float line_space)
+	{
+		const float params[3] = {size, spacing, line_space};
+
+		textLayoutKey.assign(text);
+		textLayoutKey.push_back('\0');
+		textLayoutKey.append((const char *)&font.texture.id, sizeof(font.texture.id));
+		textLayoutKey.append((const char *)params, sizeof(params));
+
+		auto found = textLayoutCache.find(textLayoutKey);
+		if (found != textLayoutCache.end())
+		{
+			return found->second;
+		}
 
-		float paddY = maxPosY;
+		//text that changes every frame would grow it forever
+		if (textLayoutCache.size() >= MAX_CACHED_TEXT_LAYOUTS)
+		{
+			textLayoutCache.clear();
+		}
 
-		paddY += font.max_height * size + bonusY;
+		auto &layout = textLayoutCache[textLayoutKey];
+		layoutText(layout, text, font, size, spacing, line_space);
+		return layout;
+	}
 
-		return glm::vec2{paddX, paddY};
+	glm::vec2 Renderer2D::getTextSize(const char *text, const Font font,
+		const float size, const float spacing, const float line_space)
+	{
+		if (font.texture.id == 0)
+		{
+			errorFunc("Missing font", userDefinedData);
+			return {};
+		}
 
+		return getTextLayout(text, font, size, spacing, line_space).size;
 	}
 
 	void Renderer2D::renderText(glm::vec2 position, const char *text, const Font font,
@@ -1240,140 +1716,37 @@ namespace gl2d
 			return;
 		}
 
-		const int text_length = (int)strlen(text);
-		Rect rectangle;
-		rectangle.x = position.x;
-		float linePositionY = position.y;
+		auto &layout = getTextLayout(text, font, size, spacing, line_space);
 
 		if (showInCenter)
 		{
-			//This is the y position we render at because it advances when we encounter newlines
-
-			float maxPos = 0;
-			float maxPosY = 0;
-
-			for (int i = 0; i < text_length; i++)
-			{
-				if (text[i] == '\n')
-				{
-					rectangle.x = position.x;
-					linePositionY += (font.max_height + line_space) * size;
-				}
-				else if (text[i] == '\t')
-				{
-					const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-					(font, '_');
-					auto x = quad.x1 - quad.x0;
-
-					rectangle.x += x * size * 3 + spacing * size;
-				}
-				else if (text[i] == ' ')
-				{
-					const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-					(font, '_');
-					auto x = quad.x1 - quad.x0;
-
-					rectangle.x += x * size + spacing * size;
-				}
-				else if (text[i] >= ' ' && text[i] <= '~')
-				{
-					const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-					(font, text[i]);
-
-					rectangle.z = quad.x1 - quad.x0;
-					rectangle.w = quad.y1 - quad.y0;
-
-					rectangle.z *= size;
-					rectangle.w *= size;
-
-					rectangle.y = linePositionY + quad.y0 * size;
-
-
-					rectangle.x += rectangle.z + spacing * size;
-					maxPos = std::max(maxPos, rectangle.x);
-					maxPosY = std::max(maxPosY, rectangle.y);
-				}
-			}
-
-			float padd = maxPos - position.x;
-			padd /= 2;
-			position.x -= padd;
-
-			float paddY = maxPosY - position.y;
-			position.y -= paddY;
+			position -= layout.centerOffset;
 		}
 
-		rectangle = {};
-		rectangle.x = position.x;
+		glm::vec4 colorData[4] = {color, color, color, color};
 
-		//This is the y position we render at because it advances when we encounter newlines
-		linePositionY = position.y;
-
-		for (int i = 0; i < text_length; i++)
+		for (auto &glyph : layout.glyphs)
 		{
-			if (text[i] == '\n')
-			{
-				rectangle.x = position.x;
-				linePositionY += (font.max_height + line_space) * size;
-			}
-			else if (text[i] == '\t')
-			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, '_');
-				auto x = quad.x1 - quad.x0;
+			Rect rectangle = glyph.rect;
+			rectangle.x += position.x;
+			rectangle.y += position.y;
 
-				rectangle.x += x * size * 3 + spacing * size;
-			}
-			else if (text[i] == ' ')
+			if (ShadowColor.w)
 			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, '_');
-				auto x = quad.x1 - quad.x0;
-				rectangle.x += x * size + spacing * size;
+				glm::vec2 pos = {-5, 3};
+				pos *= size;
+				renderRectangle({rectangle.x + pos.x, rectangle.y + pos.y,  rectangle.z, rectangle.w},
+					font.texture, ShadowColor, glm::vec2{0, 0}, 0, glyph.textureCoords);
 			}
-			else if (text[i] >= ' ' && text[i] <= '~')
-			{
 
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, text[i]);
+			renderRectangle(rectangle, font.texture, colorData, glm::vec2{0, 0}, 0, glyph.textureCoords);
 
-				rectangle.z = quad.x1 - quad.x0;
-				rectangle.w = quad.y1 - quad.y0;
-
-				rectangle.z *= size;
-				rectangle.w *= size;
-
-				//rectangle.y = linePositionY - rectangle.w;
-				rectangle.y = linePositionY + quad.y0 * size;
-
-				glm::vec4 colorData[4] = {color, color, color, color};
-
-				if (ShadowColor.w)
-				{
-					glm::vec2 pos = {-5, 3};
-					pos *= size;
-					renderRectangle({rectangle.x + pos.x, rectangle.y + pos.y,  rectangle.z, rectangle.w},
-						font.texture, ShadowColor, glm::vec2{0, 0}, 0,
-						glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1});
-
-				}
-
-				renderRectangle(rectangle, font.texture, colorData, glm::vec2{0, 0}, 0,
-					glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1});
-
-				if (LightColor.w)
-				{
-					glm::vec2 pos = {-2, 1};
-					pos *= size;
-					renderRectangle({rectangle.x + pos.x, rectangle.y + pos.y,  rectangle.z, rectangle.w},
-						font.texture,
-						LightColor, glm::vec2{0, 0}, 0,
-						glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1});
-
-				}
-
-
-				rectangle.x += rectangle.z + spacing * size;
+			if (LightColor.w)
+			{
+				glm::vec2 pos = {-2, 1};
+				pos *= size;
+				renderRectangle({rectangle.x + pos.x, rectangle.y + pos.y,  rectangle.z, rectangle.w},
+					font.texture, LightColor, glm::vec2{0, 0}, 0, glyph.textureCoords);
 			}
 		}
 	}